@@ -0,0 +1,47 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+// The nearest and farthest depth stored anywhere in one block of a DepthBuffer.
+struct DepthBlock {
+	float nearest;
+	float farthest;
+};
+
+// One float depth per pixel, from -1 at the near plane to 1 at the far plane, used to keep
+// only the nearest surface at each pixel no matter what order triangles are drawn in.
+//
+// On top of the per-pixel depths, it keeps a coarse level with the nearest and farthest depth
+// of every BLOCK_SIZE x BLOCK_SIZE block ("hierarchical Z"). A triangle that is farther away
+// than everything already in a block can skip that block without testing any of its pixels,
+// and one that is nearer than everything in it can skip the per-pixel comparisons.
+class DepthBuffer {
+public:
+	static const int32_t BLOCK_SIZE = 8;
+
+	explicit DepthBuffer(sf::Vector2u size);
+
+	sf::Vector2u getSize() const { return m_size; }
+
+	// Depths are stored row by row, with each row padded to a whole number of blocks, so code
+	// working on a block can always read all BLOCK_SIZE of its columns.
+	float* data() { return m_depths.data(); }
+	size_t getStride() const { return m_stride; }
+
+	// Resets every pixel and block to the far plane.
+	void clear();
+
+	DepthBlock& block(int32_t blockX, int32_t blockY) { return m_blocks[static_cast<size_t>(blockY) * m_blocksX + blockX]; }
+
+	// Recomputes a block's nearest and farthest depth from its pixels, after they were written.
+	void refreshBlock(int32_t blockX, int32_t blockY);
+
+private:
+	sf::Vector2u m_size;
+	size_t m_stride;
+	int32_t m_blocksX;
+	int32_t m_blocksY;
+	std::vector<float> m_depths;
+	std::vector<DepthBlock> m_blocks;
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include "framebuffer.h"
+
+// Rendering without a window. sf::RenderWindow needs a display, which build and benchmark machines
+// usually do not have, but our framebuffer does not; a headless run draws the same scene into one
+// at a chosen resolution for a fixed number of frames, then reports how long the frames took.
+struct HeadlessOptions {
+	// --headless WxH: render offscreen at this resolution instead of opening a window.
+	bool enabled{ false };
+	sf::Vector2u resolution{ 1920, 1080 };
+	// --frames N: how many frames to render.
+	size_t frames{ 300 };
+	// --output FILE: save the last frame (see Framebuffer::saveToFile). Empty saves nothing.
+	std::string outputPath;
+	// True once --frames or --output is given. They only mean something with --headless, and the
+	// demos reject them without it.
+	bool frameOptionsGiven{ false };
+};
+
+// The options above, for the demos' usage messages.
+extern const char* const HEADLESS_USAGE;
+
+// Consumes a headless option at argv[i], along with its value, leaving i on the last argument
+// used. Returns false if argv[i] is not a headless option, so the caller can try its own options.
+// Exits with a message if the value is missing or malformed.
+bool parseHeadlessOption(int argc, char* argv[], int& i, HeadlessOptions& options);
+
+// Calls renderFrame once per frame, timing each call, then prints the frame time statistics and
+// saves the last frame if asked. Returns the program's exit code.
+int runHeadless(const HeadlessOptions& options, Framebuffer& framebuffer, const std::function<void()>& renderFrame);
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+
+// A whole file mapped read-only into memory. The operating system pages it in as it is read, so
+// opening even a very large file costs nothing up front and nothing is copied.
+class MappedFile {
+public:
+	MappedFile() = default;
+	// Maps the file at path. isOpen() is false if it does not exist or cannot be mapped.
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool isOpen() const { return m_open; }
+	// The file's contents, valid as long as the mapping lives. Empty for an empty file.
+	std::span<const std::byte> bytes() const { return { static_cast<const std::byte*>(m_data), m_size }; }
+
+private:
+	void close();
+
+	bool m_open{ false };
+	const void* m_data{ nullptr };
+	size_t m_size{ 0 };
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+struct Vertex3D {
+	float x;
+	float y;
+	float z;
+};
+
+// An affine transform stored as a 3x4 matrix: a 3x3 linear part in the first three columns and a
+// translation in the last.
+struct AffineTransform {
+	float m[3][4];
+};
+
+// Bounds of a mesh in its own local space, computed once when the mesh is loaded: an
+// axis-aligned box, and a sphere around the box's center that contains every vertex.
+struct MeshBounds {
+	Vertex3D min;
+	Vertex3D max;
+	Vertex3D center;
+	float radius;
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "mapped_file.h"
+#include "mesh.h"
+
+// A binary copy of an imported mesh, so later runs can skip Assimp entirely. The file is a
+// MeshCacheHeader followed by the raw Vertex3D array and then the face indexes, 16 or 32 bits wide,
+// laid out exactly as they are in memory: reading it is mapping it, with no parsing and no
+// copying. The header records a MeshCacheKey, and a cache whose key does not match is ignored and
+// rewritten.
+
+// Everything that decides what a cache holds: the source file, and how it was turned into a mesh.
+struct MeshCacheKey {
+	// hashBytes of the source file, and its size.
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	// Which loader read the source, as a number the caller assigns. Different loaders may order
+	// or split vertices differently.
+	uint32_t loader;
+	// Options given to that loader, such as Assimp's post-processing flags.
+	uint32_t importFlags;
+	// Passes run on the mesh after loading it, such as those in mesh_optimizer.h, as bits the
+	// caller assigns.
+	uint32_t passes;
+};
+
+// The most vertices 16-bit indexes can address.
+const size_t MAX_16_BIT_VERTICES{ 65536 };
+
+// A mesh's vertices, faces, and bounds, either owned or viewed in place in a mapped cache file.
+// The face indexes are stored as Index, either uint16_t or uint32_t: most meshes, like the bunny,
+// have few enough vertices for 16 bits, which halves the memory their faces take and the bandwidth
+// spent reading them every frame.
+// Moving it keeps the spans valid; copying is not allowed, as the copy's spans would not be.
+template <typename Index>
+class LoadedMesh {
+public:
+	using IndexType = Index;
+	static constexpr size_t INDEX_BYTES{ sizeof(Index) };
+
+	// Takes over vectors filled by an import.
+	LoadedMesh(std::vector<Vertex3D> vertices, std::vector<Index> faces, const MeshBounds& bounds)
+		: m_ownedVertices{ std::move(vertices) }, m_ownedFaces{ std::move(faces) },
+		m_vertices{ m_ownedVertices }, m_faces{ m_ownedFaces }, m_bounds{ bounds } {
+	}
+	// Views arrays that live inside the mapped file.
+	LoadedMesh(MappedFile file, std::span<const Vertex3D> vertices, std::span<const Index> faces, const MeshBounds& bounds)
+		: m_file{ std::move(file) }, m_vertices{ vertices }, m_faces{ faces }, m_bounds{ bounds } {
+	}
+
+	LoadedMesh(LoadedMesh&&) noexcept = default;
+	LoadedMesh& operator=(LoadedMesh&&) noexcept = default;
+	LoadedMesh(const LoadedMesh&) = delete;
+	LoadedMesh& operator=(const LoadedMesh&) = delete;
+
+	std::span<const Vertex3D> vertices() const { return m_vertices; }
+	std::span<const Index> faces() const { return m_faces; }
+	const MeshBounds& bounds() const { return m_bounds; }
+	// True if the arrays are read straight from a cache file.
+	bool isMapped() const { return m_file.isOpen(); }
+
+private:
+	MappedFile m_file;
+	std::vector<Vertex3D> m_ownedVertices;
+	std::vector<Index> m_ownedFaces;
+	std::span<const Vertex3D> m_vertices;
+	std::span<const Index> m_faces;
+	MeshBounds m_bounds;
+};
+
+// A mesh with the narrowest index width that fits its vertex count. Code that draws it uses
+// std::visit to get at the LoadedMesh inside with its real index type.
+using AnyLoadedMesh = std::variant<LoadedMesh<uint16_t>, LoadedMesh<uint32_t>>;
+
+// A 64-bit hash of a file's contents, to tell whether a cache still matches its source.
+uint64_t hashBytes(std::span<const std::byte> bytes);
+
+// Where the cache for a source file lives: next to it, with ".meshcache" appended.
+std::string meshCachePath(const std::string& sourcePath);
+
+// Maps the cache at cachePath, if there is one that was made with this key. Returns nothing for a
+// missing, stale, or damaged cache, including one with a face index past the end of its vertices or
+// with indexes wider or narrower than its vertex count calls for.
+std::optional<AnyLoadedMesh> readMeshCache(const std::string& cachePath, const MeshCacheKey& key);
+
+// Writes a cache for a mesh loaded with this key. The file is written under a temporary name and
+// then renamed, so an interrupted write never leaves a damaged cache.
+// Returns false if it could not be written, for example in a read-only directory.
+bool writeMeshCache(const std::string& cachePath, const MeshCacheKey& key, const LoadedMesh<uint16_t>& mesh);
+bool writeMeshCache(const std::string& cachePath, const MeshCacheKey& key, const LoadedMesh<uint32_t>& mesh);
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "mesh.h"
+
+// Load-time passes that reorder a mesh for faster drawing without changing what is drawn.
+//
+// A mesh's faces come in whatever order its file had, so consecutive triangles often use vertices
+// far apart in the vertex array, and a vertex shared by six triangles may be fetched six times
+// from six distant places. optimizeVertexCache reorders the triangles so each one mostly reuses
+// vertices used by the triangles just before it, which is what a GPU's post-transform cache
+// rewards; optimizeVertexFetch then renumbers the vertices in the order the triangles first use
+// them, so walking the faces walks the vertex array (and our renderer's screen vertices) nearly
+// front to back.
+
+// Reorders triangles with Tom Forsyth's "Linear-Speed Vertex Cache Optimisation": each step
+// emits the triangle whose vertices score highest, where a vertex scores higher the more recently
+// it was used and the fewer triangles it still has left to be drawn in. `vertexCount` is the
+// number of vertices the faces index.
+void optimizeVertexCache(std::span<uint32_t> faces, size_t vertexCount);
+
+// Renumbers vertices in the order the faces first use them, updating the faces to match.
+// Vertices no face uses are dropped.
+void optimizeVertexFetch(std::vector<Vertex3D>& vertices, std::span<uint32_t> faces);
+
+// The average cache miss ratio of drawing these faces through a first-in, first-out cache of
+// cacheSize transformed vertices: how many vertices had to be transformed per triangle. It is 3
+// with no reuse at all and approaches 0.5 for a large, perfectly ordered grid.
+double averageCacheMissRatio(std::span<const uint32_t> faces, size_t vertexCount, size_t cacheSize);
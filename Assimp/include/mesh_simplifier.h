@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "mesh.h"
+
+// Mesh simplification by quadric error edge collapse (Garland and Heckbert, "Surface
+// Simplification Using Quadric Error Metrics"), for building levels of detail at load time.
+//
+// Every vertex starts with a quadric: the sum of the squared distances to the planes of the
+// triangles around it, weighted by their areas. Collapsing an edge moves one of its vertices onto
+// the other and adds their quadrics, so the quadric of a vertex always measures how far it has
+// drifted from all the original triangles it now stands for. Each pass collapses the cheapest
+// edges first, skipping any collapse that would flip a triangle over, until the mesh is small
+// enough or the next collapse would cost more than the error allowed. Edges on the border of a
+// mesh with holes get an extra plane at right angles to their triangle, so the holes keep their
+// shape. Vertices are only ever moved onto other vertices, never to new positions, so every
+// level's vertices are a subset of the original's; buildLodChain copies the ones a level still
+// uses into a smaller array of its own.
+//
+// Errors are distances from the original surface, as fractions of the radius of the sphere around
+// the mesh's bounding box, so the same error means the same thing for meshes of any size.
+
+// Simplifies the faces until they have at most targetIndexCount indexes, or until every remaining
+// collapse would move the surface more than maxError. Returns the new faces, indexing the same
+// vertices, and sets resultError to the largest error of any collapse made.
+std::vector<uint32_t> simplifyMesh(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces,
+	size_t targetIndexCount, float maxError, float& resultError);
+
+// One level of detail: a simplified copy of a mesh with only the vertices its faces use, ordered
+// for locality (see mesh_optimizer.h), and the error it was simplified to.
+struct MeshLevel {
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> faces;
+	float error;
+};
+
+// Builds a chain of levels after the original mesh, one per entry of maxErrors, which should be
+// increasing. Each level aims for half the triangles of the one before it, without exceeding its
+// error. The chain ends early when a level would not be meaningfully smaller than the last.
+std::vector<MeshLevel> buildLodChain(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces,
+	std::span<const float> maxErrors);
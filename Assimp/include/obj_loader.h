@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "mesh.h"
+#include "thread_pool.h"
+
+// A loader for the plain Wavefront OBJ files our models come in, much faster than going through
+// Assimp because it does only what such files need. It reads the positions in `v` records and
+// the corners of `f` records, which may be written as v, v/vt, v//vn, or v/vt/vn and may be
+// negative (counted back from the latest vertex). Faces with more than three corners are split
+// into fans of triangles. Texture coordinates, normals, groups, and materials are skipped.
+//
+// The text is split into chunks at line boundaries. One pass over all the chunks counts their
+// vertices, so each chunk knows where its vertices go in the output; a second pass then parses
+// every chunk on the pool's threads at the same time, with std::from_chars for every number.
+
+// Parses OBJ text into vertices and triangle indexes, in the same layout as a flattened Assimp import.
+// Returns false and describes the first problem in error if the text is malformed or refers to
+// vertices that do not exist.
+bool parseObj(std::span<const std::byte> text, ThreadPool& pool, std::vector<Vertex3D>& vertices,
+	std::vector<uint32_t>& faces, std::string& error);
@@ -0,0 +1,97 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "depth_buffer.h"
+#include "framebuffer.h"
+#include "thread_pool.h"
+
+// A vertex after clipToScreen: its pixel position, and its depth from -1 at the near plane to
+// 1 at the far plane.
+struct ScreenVertex {
+	sf::Vector2i position;
+	float depth;
+
+	bool operator==(const ScreenVertex&) const = default;
+};
+
+// A face after setup: its three transformed corners, ready to rasterize.
+struct ScreenTriangle {
+	ScreenVertex a;
+	ScreenVertex b;
+	ScreenVertex c;
+
+	bool operator==(const ScreenTriangle&) const = default;
+};
+
+// Counts of the work TileRasterizer::draw did, to see how much overdraw there is and how much
+// of it the depth buffer saves.
+struct RasterStats {
+	// Covered pixels that were depth tested, or simply written when there is no depth buffer.
+	size_t pixelsTested{ 0 };
+	// Pixels written. Divided by the framebuffer's pixel count, this is the overdraw per frame.
+	size_t pixelsWritten{ 0 };
+	// Depth buffer blocks skipped without testing a pixel, because the triangle was behind
+	// everything already in them.
+	size_t blocksRejected{ 0 };
+	// Triangles (counted once per tile they overlap) with every block they touch rejected.
+	size_t trianglesRejected{ 0 };
+
+	RasterStats& operator+=(const RasterStats& other);
+};
+
+// Ways of evaluating a triangle's edge functions over its bounding box, from narrowest to widest.
+enum class RasterPath {
+	Scalar, // One pixel per iteration.
+	AVX2    // 8 pixels per iteration, producing a coverage mask for masked stores.
+};
+
+// The widest path this CPU and operating system support. Checked once, then cached.
+RasterPath detectRasterPath();
+const char* rasterPathName(RasterPath path);
+
+// Fills one triangle into the framebuffer on the calling thread, and returns how many pixels it
+// wrote. A pixel is covered when its centre is inside the triangle. Centres exactly on an edge
+// follow the top-left rule, so two triangles sharing an edge never both cover (or both skip)
+// the same pixel. Triangles may wind either way; degenerate ones are skipped.
+size_t fillTriangle(Framebuffer& framebuffer, sf::Vector2i a, sf::Vector2i b, sf::Vector2i c,
+	sf::Color color, RasterPath path);
+size_t fillTriangle(Framebuffer& framebuffer, sf::Vector2i a, sf::Vector2i b, sf::Vector2i c, sf::Color color);
+
+// Fills triangles into a Framebuffer using several threads. Each frame, triangles are first
+// sorted ("binned") into the TILE_SIZE x TILE_SIZE screen tiles that their bounding boxes
+// overlap. Then every tile is filled by exactly one thread, drawing its bin in submission order.
+// No two threads ever write the same pixel, so there are no locks or atomics on the framebuffer,
+// and a tile's 16 KB of pixels stays in the filling core's cache while it works through the bin.
+class TileRasterizer {
+public:
+	static const int32_t TILE_SIZE = 64;
+
+	// Fills every triangle in the given color, with the same coverage rules as fillTriangle.
+	// Without a depth buffer, later triangles simply cover earlier ones.
+	void draw(Framebuffer& framebuffer, ThreadPool& pool, const std::vector<ScreenTriangle>& triangles, sf::Color color);
+	// Only writes pixels nearer than what the depth buffer already holds there, and records
+	// their depth. The depth buffer must be the same size as the framebuffer.
+	void draw(Framebuffer& framebuffer, DepthBuffer& depthBuffer, ThreadPool& pool,
+		const std::vector<ScreenTriangle>& triangles, sf::Color color);
+
+	// Totals of every draw since the last resetStats.
+	const RasterStats& getStats() const { return m_stats; }
+	void resetStats() { m_stats = RasterStats{}; }
+
+private:
+	void drawTiles(Framebuffer& framebuffer, DepthBuffer* depthBuffer, ThreadPool& pool,
+		const std::vector<ScreenTriangle>& triangles, sf::Color color);
+	void resize(sf::Vector2u framebufferSize);
+	void bin(const std::vector<ScreenTriangle>& triangles);
+
+	sf::Vector2u m_framebufferSize{ 0, 0 };
+	int32_t m_tilesX{ 0 };
+	int32_t m_tilesY{ 0 };
+	// For each tile, row by row, the indexes of the triangles overlapping it. The lists are
+	// cleared but not freed between frames.
+	std::vector<std::vector<uint32_t>> m_bins;
+	// Each tile's counts from the current draw, summed into m_stats once every tile is done.
+	std::vector<RasterStats> m_tileStats;
+	RasterStats m_stats;
+};
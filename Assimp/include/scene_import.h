@@ -0,0 +1,59 @@
+#pragma once
+#include <assimp/postprocess.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mesh.h"
+
+// Importing whole scenes with Assimp. Every mesh in the file is packed into one vertex array and
+// one index array, and every node that places a mesh becomes an instance of it, carrying the
+// node's transform relative to the scene's root.
+
+// Assimp's heaviest preset: smooth normals, tangents, vertex cache optimization, and more.
+const unsigned int IMPORT_FULL = aiProcessPreset_TargetRealtime_MaxQuality;
+// Just what our renderer needs: triangles, with each vertex shared by the faces around it.
+const unsigned int IMPORT_MINIMAL = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices;
+
+// Where one mesh sits in an ImportedScene's arrays. Its indexes count from firstVertex, so the
+// mesh can be drawn from subspans of the two arrays.
+struct MeshRange {
+	std::string name;
+	uint32_t firstVertex;
+	uint32_t vertexCount;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+// One placement of a mesh: a node that references it, and that node's transform to scene space.
+struct MeshInstance {
+	uint32_t mesh;
+	AffineTransform transform;
+};
+
+// How long one step of an import took.
+struct ImportStepTime {
+	std::string step;
+	double milliseconds;
+};
+
+struct ImportedScene {
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshRange> meshes;
+	std::vector<MeshInstance> instances;
+	// Reading the file, then each post-processing step, in the order they ran.
+	std::vector<ImportStepTime> steps;
+	// Points and lines, which our renderer cannot draw, so the import leaves them out.
+	size_t skippedPrimitives{ 0 };
+};
+
+// Imports every mesh and node in the file. The post-processing steps in `flags` run one at a time,
+// in approximately the order Assimp would run them together, so that each one can be timed (see
+// POST_PROCESS_STEPS in scene_import.cpp for where the result can differ). Exits with Assimp's
+// message if the import fails.
+ImportedScene importScene(const std::string& path, unsigned int flags);
+
+// Bakes each instance's transform into a copy of its mesh's vertices and appends them all to
+// vertices and faces as a single mesh, for drawing the whole scene as one object.
+void flattenScene(const ImportedScene& scene, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces);
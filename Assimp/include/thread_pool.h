@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that split loops over large arrays between them. The thread that
+// calls parallelFor does a share of the work too, so a pool of N threads starts N - 1 workers.
+class ThreadPool {
+public:
+	// Defaults to one thread per hardware thread.
+	explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t getThreadCount() const { return m_workers.size() + 1; }
+
+	// Calls body(begin, end) for consecutive, non-overlapping chunks of [0, count), spread across
+	// the threads, and returns once every chunk is finished. Chunks hold at least minChunkSize
+	// items. As long as the body only writes to its own index range, the output is the same no
+	// matter how the chunks were scheduled.
+	void parallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)>& body);
+
+private:
+	void workerLoop();
+	void runChunks();
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_workReady;
+	std::condition_variable m_workDone;
+	bool m_stopping{ false };
+	// Incremented for every parallelFor, so sleeping workers can tell a new job has arrived.
+	size_t m_generation{ 0 };
+	size_t m_busyWorkers{ 0 };
+
+	// The current job.
+	const std::function<void(size_t, size_t)>* m_body{ nullptr };
+	size_t m_count{ 0 };
+	size_t m_chunkSize{ 0 };
+	size_t m_chunkCount{ 0 };
+	std::atomic<size_t> m_nextChunk{ 0 };
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// A timeline of named spans, for seeing where the time in a frame goes rather than only how much
+// each stage takes on average. Spans are recorded per thread, from the start of the program for
+// a fixed number of frames, then written as Chrome trace-event JSON, which chrome://tracing and
+// ui.perfetto.dev both open. Spans cost one check of a flag while no trace is being recorded.
+struct TraceOptions {
+	// --trace FILE: where to write the trace. Empty records nothing.
+	std::string path;
+	// --trace-frames N: how many frames to record before writing the file.
+	size_t frames{ 100 };
+};
+
+// The options above, for the demos' usage messages.
+extern const char* const TRACE_USAGE;
+
+// Consumes a trace option at argv[i], along with its value, leaving i on the last argument used.
+// Returns false if argv[i] is not a trace option. Exits with a message if the value is missing or
+// malformed.
+bool parseTraceOption(int argc, char* argv[], int& i, TraceOptions& options);
+
+// Starts recording if the options name a file. The calling thread is named "main" in the trace.
+void startTrace(const TraceOptions& options);
+
+// True while a trace is being recorded.
+bool traceActive();
+
+// Gives the calling thread a name to show in the trace viewer instead of its number. Does nothing
+// unless a trace has started.
+void nameTraceThread(const std::string& name);
+
+// Called by the main thread at the start of every frame. Once the requested number of frames
+// has been recorded, writes the file and stops recording.
+void advanceTraceFrame();
+
+// Writes the file if the trace is still recording, for runs that end before enough frames.
+void finishTrace();
+
+// Records the time from its construction to the end of the enclosing scope as a span on the
+// calling thread. The name must outlive the trace, so it is normally a string literal.
+class TraceSpan {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	explicit TraceSpan(const char* name) : m_name{ traceActive() ? name : nullptr } {
+		if (m_name != nullptr) {
+			m_start = Clock::now();
+		}
+	}
+	~TraceSpan();
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+	const char* m_name;
+	Clock::time_point m_start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// Records the rest of the enclosing scope as a span with the given name.
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__){ name }
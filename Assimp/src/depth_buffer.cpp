@@ -0,0 +1,33 @@
+#include "depth_buffer.h"
+#include <algorithm>
+
+namespace {
+	const float FAR_DEPTH{ 1.0f };
+}
+
+DepthBuffer::DepthBuffer(sf::Vector2u size)
+	: m_size{ size },
+	m_stride{ (size.x + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE },
+	m_blocksX{ static_cast<int32_t>((size.x + BLOCK_SIZE - 1) / BLOCK_SIZE) },
+	m_blocksY{ static_cast<int32_t>((size.y + BLOCK_SIZE - 1) / BLOCK_SIZE) },
+	m_depths(m_stride * m_blocksY * BLOCK_SIZE, FAR_DEPTH),
+	m_blocks(static_cast<size_t>(m_blocksX) * m_blocksY, DepthBlock{ FAR_DEPTH, FAR_DEPTH }) {
+}
+
+void DepthBuffer::clear() {
+	std::fill(m_depths.begin(), m_depths.end(), FAR_DEPTH);
+	std::fill(m_blocks.begin(), m_blocks.end(), DepthBlock{ FAR_DEPTH, FAR_DEPTH });
+}
+
+void DepthBuffer::refreshBlock(int32_t blockX, int32_t blockY) {
+	const float* row{ m_depths.data() + static_cast<size_t>(blockY) * BLOCK_SIZE * m_stride + static_cast<size_t>(blockX) * BLOCK_SIZE };
+	float nearest{ row[0] };
+	float farthest{ row[0] };
+	for (int32_t y{ 0 }; y < BLOCK_SIZE; ++y, row += m_stride) {
+		for (int32_t x{ 0 }; x < BLOCK_SIZE; ++x) {
+			nearest = std::min(nearest, row[x]);
+			farthest = std::max(farthest, row[x]);
+		}
+	}
+	block(blockX, blockY) = DepthBlock{ nearest, farthest };
+}
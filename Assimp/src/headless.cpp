@@ -0,0 +1,110 @@
+#include "headless.h"
+#include "profiler.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+const char* const HEADLESS_USAGE{ "[--headless WxH [--frames N] [--output FILE.png|FILE.ppm]]" };
+
+namespace {
+	// Parses a whole string as a positive integer.
+	bool parsePositive(std::string_view text, unsigned long& value) {
+		auto [end, error] { std::from_chars(text.data(), text.data() + text.size(), value) };
+		return error == std::errc{} && end == text.data() + text.size() && value > 0;
+	}
+
+	// Parses a resolution written as WIDTHxHEIGHT, like 1920x1080.
+	bool parseResolution(std::string_view text, sf::Vector2u& resolution) {
+		size_t separator{ text.find('x') };
+		unsigned long width{ 0 };
+		unsigned long height{ 0 };
+		if (separator == std::string_view::npos || !parsePositive(text.substr(0, separator), width)
+			|| !parsePositive(text.substr(separator + 1), height)) {
+			return false;
+		}
+		resolution = sf::Vector2u{ static_cast<unsigned>(width), static_cast<unsigned>(height) };
+		return true;
+	}
+
+	// The frame time below which the given fraction of frames fall, from times sorted in
+	// increasing order.
+	double percentile(const std::vector<double>& milliseconds, double fraction) {
+		size_t index{ static_cast<size_t>(fraction * (milliseconds.size() - 1) + 0.5) };
+		return milliseconds[index];
+	}
+}
+
+bool parseHeadlessOption(int argc, char* argv[], int& i, HeadlessOptions& options) {
+	std::string_view arg{ argv[i] };
+	if (arg != "--headless" && arg != "--frames" && arg != "--output") {
+		return false;
+	}
+	if (i + 1 >= argc) {
+		std::cout << arg << " needs a value" << std::endl;
+		exit(1);
+	}
+	std::string_view value{ argv[++i] };
+	unsigned long frames{ 0 };
+	if (arg == "--headless") {
+		if (!parseResolution(value, options.resolution)) {
+			std::cout << "--headless needs a resolution like 1920x1080, not " << value << std::endl;
+			exit(1);
+		}
+		options.enabled = true;
+	}
+	else if (arg == "--frames") {
+		if (!parsePositive(value, frames)) {
+			std::cout << "--frames needs a positive number, not " << value << std::endl;
+			exit(1);
+		}
+		options.frames = frames;
+		options.frameOptionsGiven = true;
+	}
+	else {
+		options.outputPath = value;
+		options.frameOptionsGiven = true;
+	}
+	return true;
+}
+
+int runHeadless(const HeadlessOptions& options, Framebuffer& framebuffer, const std::function<void()>& renderFrame) {
+	std::vector<double> milliseconds;
+	milliseconds.reserve(options.frames);
+	sf::Clock total;
+	for (size_t frame{ 0 }; frame < options.frames; ++frame) {
+		sf::Clock clock;
+		{
+			PROFILE_STAGE(ProfileStage::Frame);
+			renderFrame();
+		}
+		milliseconds.push_back(clock.getElapsedTime().asMicroseconds() / 1000.0);
+	}
+	double seconds{ total.getElapsedTime().asMicroseconds() / 1e6 };
+
+	double sum{ 0.0 };
+	for (double time : milliseconds) {
+		sum += time;
+	}
+	double mean{ sum / milliseconds.size() };
+	std::sort(milliseconds.begin(), milliseconds.end());
+	std::cout << options.frames << " frames at " << options.resolution.x << "x" << options.resolution.y
+		<< " in " << seconds << " s, " << options.frames / seconds << " FPS" << std::endl;
+	std::cout << "frame time (ms): mean " << mean << ", min " << percentile(milliseconds, 0.0)
+		<< ", median " << percentile(milliseconds, 0.5) << ", p95 " << percentile(milliseconds, 0.95)
+		<< ", p99 " << percentile(milliseconds, 0.99) << ", max " << percentile(milliseconds, 1.0) << std::endl;
+#ifdef ENABLE_PROFILER
+	stageProfiler().report(std::cout);
+#endif
+
+	if (!options.outputPath.empty()) {
+		if (!framebuffer.saveToFile(options.outputPath)) {
+			std::cout << "Could not save the last frame to " << options.outputPath << std::endl;
+			return 1;
+		}
+		std::cout << "Saved the last frame to " << options.outputPath << std::endl;
+	}
+	return 0;
+}
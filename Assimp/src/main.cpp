@@ -6,23 +6,42 @@
 */
 #include <SFML/Graphics.hpp>
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <random>
+#include <span>
 #include <glm/ext.hpp>
 #include <vector>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "obj_loader.h"
+#include "scene_import.h"
 #include "triangles.h"
+#include "edges.h"
+#include "thread_pool.h"
+#include "rasterizer.h"
+#include "culling.h"
+#include "headless.h"
+#include "profiler.h"
+#include "trace.h"
 #define _USE_MATH_DEFINES // for M_PI
 #include <math.h>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
 
 
-#define LOG_FPS
-struct Vertex3D {
-	float x;
-	float y;
-	float z;
-};
 struct Frustum {
 	float near;
 	float far; 
@@ -33,41 +52,44 @@ struct Frustum {
 const size_t FLOATS_PER_VERTEX = 3;
 const size_t VERTICES_PER_FACE = 3;
 
-// Reads the vertices and faces of an Assimp mesh, and uses them to initialize mesh structures
-// compatible with the rest of our application.
-void fromAssimpMesh(const aiMesh* mesh, std::vector<Vertex3D> &vertices,
-	std::vector<uint32_t> &faces) {
-	for (size_t i = 0; i < mesh->mNumVertices; i++) {
-		// Each "vertex" from Assimp has to be transformed into a Vertex3D in our application.
-		vertices.push_back({ mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z });
-	}
-
-	faces.reserve(mesh->mNumFaces * VERTICES_PER_FACE);
-	for (size_t i = 0; i < mesh->mNumFaces; i++) {
-		// We assume the faces are triangular, so we push three face indexes at a time into our faces list.
-		faces.push_back(mesh->mFaces[i].mIndices[0]);
-		faces.push_back(mesh->mFaces[i].mIndices[1]);
-		faces.push_back(mesh->mFaces[i].mIndices[2]);
-	}
+// Loads an asset file supported by Assimp, post-processed with the given steps, and fills in the
+// given vertices and faces lists with every mesh in its scene, each placed where its nodes put it
+// (see flattenScene). Returns the imported scene, for its layout and step timings.
+ImportedScene assimpLoad(const std::string& path, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces,
+	unsigned int flags) {
+	TRACE_SPAN("load");
+	ImportedScene scene = importScene(path, flags);
+	flattenScene(scene, vertices, faces);
+	return scene;
 }
 
-// Loads an asset file supported by Assimp, extracts the first mesh in the file, and fills in the 
-// given vertices and faces lists with its data.
-void assimpLoad(const std::string& path, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces) {
-	Assimp::Importer importer;
-
-	const aiScene* scene = importer.ReadFile(path, aiProcessPreset_TargetRealtime_MaxQuality);
-
-	// If the import failed, report it
-	if (nullptr == scene) {
-		std::cout << "ASSIMP ERROR" << importer.GetErrorString() << std::endl;
+// Parses an OBJ file that is already mapped with our own loader, and reports problems the same
+// way assimpLoad does.
+void objLoad(const std::string& path, const MappedFile& source, ThreadPool& pool, std::vector<Vertex3D>& vertices,
+	std::vector<uint32_t>& faces) {
+	TRACE_SPAN("parseObj");
+	std::string error;
+	if (!source.isOpen()) {
+		std::cout << "OBJ ERROR: could not open " << path << std::endl;
 		exit(1);
 	}
-	else {
-		fromAssimpMesh(scene->mMeshes[0], vertices, faces);
+	if (!parseObj(source.bytes(), pool, vertices, faces, error)) {
+		std::cout << "OBJ ERROR in " << path << ": " << error << std::endl;
+		exit(1);
 	}
 }
 
+// Which code turns a model file into vertices and faces. It is chosen per load, so the two can be
+// compared; both produce the same layout, for the same cache and renderer.
+enum class MeshLoader {
+	Assimp, // Any format Assimp reads, with the post-processing chosen by --import.
+	Obj     // Our parallel OBJ parser (see obj_loader.h): plain OBJ files only, but far faster.
+};
+
+const char* meshLoaderName(MeshLoader loader) {
+	return loader == MeshLoader::Assimp ? "Assimp" : "the OBJ parser";
+}
+
 Vertex3D localToWorld(
 	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale,
 	const Vertex3D& vertex) {
@@ -101,65 +123,1233 @@ Vertex3D localToWorld(
 	return Vertex3D(translateX, translateY, translateZ);
 }
 
+// Compiling an object's position, orientation, and scale into an AffineTransform (see mesh.h)
+// once per draw call replaces the sines and cosines that localToWorld evaluates for every vertex.
+
+// Returns the transform that applies `first`, then `second`.
+AffineTransform compose(const AffineTransform& second, const AffineTransform& first) {
+	AffineTransform result = {};
+	for (int row = 0; row < 3; ++row) {
+		for (int col = 0; col < 4; ++col) {
+			result.m[row][col] = second.m[row][0] * first.m[0][col]
+				+ second.m[row][1] * first.m[1][col]
+				+ second.m[row][2] * first.m[2][col];
+		}
+		result.m[row][3] += second.m[row][3];
+	}
+	return result;
+}
+
+// Rotations around a single axis, matching the yaw, pitch, and roll steps of localToWorld.
+AffineTransform yawTransform(float angle) {
+	float c = std::cos(angle);
+	float s = std::sin(angle);
+	return AffineTransform{ {
+		{ c, 0, s, 0 },
+		{ 0, 1, 0, 0 },
+		{ -s, 0, c, 0 }
+	} };
+}
+
+AffineTransform pitchTransform(float angle) {
+	float c = std::cos(angle);
+	float s = std::sin(angle);
+	return AffineTransform{ {
+		{ 1, 0, 0, 0 },
+		{ 0, c, -s, 0 },
+		{ 0, s, c, 0 }
+	} };
+}
+
+AffineTransform rollTransform(float angle) {
+	float c = std::cos(angle);
+	float s = std::sin(angle);
+	return AffineTransform{ {
+		{ c, -s, 0, 0 },
+		{ s, c, 0, 0 },
+		{ 0, 0, 1, 0 }
+	} };
+}
+
+// The same transformation as localToWorld, compiled once for the whole object.
+AffineTransform localToWorldTransform(
+	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale) {
+	AffineTransform transform = compose(rollTransform(orientation.z),
+		compose(pitchTransform(orientation.x), yawTransform(orientation.y)));
+
+	// Scaling after rotating multiplies each row by its axis' scale; translating fills in the
+	// last column.
+	float axisScale[3] = { scale.x, scale.y, scale.z };
+	for (int row = 0; row < 3; ++row) {
+		for (int col = 0; col < 3; ++col) {
+			transform.m[row][col] *= axisScale[row];
+		}
+	}
+	transform.m[0][3] = position.x;
+	transform.m[1][3] = position.y;
+	transform.m[2][3] = position.z;
+	return transform;
+}
+
+// Applies an affine transform to a vertex: three multiply-add chains, which the compiler can emit
+// as fused multiply-add instructions.
+Vertex3D transformVertex(const AffineTransform& transform, const Vertex3D& vertex) {
+	const auto& m = transform.m;
+	return Vertex3D(
+		m[0][0] * vertex.x + m[0][1] * vertex.y + m[0][2] * vertex.z + m[0][3],
+		m[1][0] * vertex.x + m[1][1] * vertex.y + m[1][2] * vertex.z + m[1][3],
+		m[2][0] * vertex.x + m[2][1] * vertex.y + m[2][2] * vertex.z + m[2][3]
+	);
+}
+
+// The compiled transforms perform the same arithmetic as the step-by-step functions, grouped
+// differently, so the two paths differ only by float rounding. We consider them to match when
+// each coordinate agrees to within TRANSFORM_TOLERANCE, relative to the coordinate's magnitude
+// (or absolutely, for coordinates smaller than 1).
+const float TRANSFORM_TOLERANCE = 1e-4f;
+
+bool matchesWithinTolerance(const Vertex3D& actual, const Vertex3D& expected) {
+	auto close = [](float a, float e) {
+		return std::abs(a - e) <= TRANSFORM_TOLERANCE * std::max(1.0f, std::abs(e));
+	};
+	return close(actual.x, expected.x) && close(actual.y, expected.y) && close(actual.z, expected.z);
+}
+
+// Computes a mesh's bounds (see mesh.h).
+MeshBounds computeBounds(std::span<const Vertex3D> vertices) {
+	TRACE_SPAN("computeBounds");
+	if (vertices.empty()) {
+		return MeshBounds();
+	}
+	MeshBounds bounds = MeshBounds(vertices[0], vertices[0], vertices[0], 0.0f);
+	for (const Vertex3D& vertex : vertices) {
+		bounds.min = Vertex3D(std::min(bounds.min.x, vertex.x), std::min(bounds.min.y, vertex.y), std::min(bounds.min.z, vertex.z));
+		bounds.max = Vertex3D(std::max(bounds.max.x, vertex.x), std::max(bounds.max.y, vertex.y), std::max(bounds.max.z, vertex.z));
+	}
+	bounds.center = Vertex3D((bounds.min.x + bounds.max.x) / 2, (bounds.min.y + bounds.max.y) / 2, (bounds.min.z + bounds.max.z) / 2);
+	float radiusSquared = 0;
+	for (const Vertex3D& vertex : vertices) {
+		float dx = vertex.x - bounds.center.x;
+		float dy = vertex.y - bounds.center.y;
+		float dz = vertex.z - bounds.center.z;
+		radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+	}
+	bounds.radius = std::sqrt(radiusSquared);
+	return bounds;
+}
+
+// Copies 32-bit indexes into indexes of the given width. Every index must fit in it.
+template <typename Index>
+std::vector<Index> toIndexWidth(std::span<const uint32_t> indexes) {
+	return std::vector<Index>(indexes.begin(), indexes.end());
+}
+
+// The cache size averageCacheMissRatio reports for: a typical GPU's post-transform cache.
+const size_t REPORTED_CACHE_SIZE = 16;
+
+// Loads a mesh from its binary cache (see mesh_cache.h) when there is one that matches the
+// source file, loader, import flags, and optimization, mapping it without parsing or copying
+// anything. Otherwise loads it with the given loader, reorders it for locality if `optimize` is
+// set (see mesh_optimizer.h), and writes a fresh cache for the next run. The mesh gets 16-bit face
+// indexes if it has few enough vertices for them, and 32-bit ones otherwise.
+AnyLoadedMesh loadMesh(const std::string& path, MeshLoader loader, unsigned int importFlags, bool optimize, ThreadPool& pool) {
+	TRACE_SPAN("loadMesh");
+	sf::Clock clock;
+	MappedFile source = MappedFile(path);
+	uint64_t sourceHash = 0;
+	{
+		TRACE_SPAN("hash source");
+		sourceHash = hashBytes(source.bytes());
+	}
+	MeshCacheKey key = MeshCacheKey(sourceHash, source.bytes().size(), static_cast<uint32_t>(loader),
+		loader == MeshLoader::Assimp ? importFlags : 0, optimize ? 1u : 0u);
+	std::string cachePath = meshCachePath(path);
+
+	if (source.isOpen()) {
+		TRACE_SPAN("read cache");
+		std::optional<AnyLoadedMesh> cached = readMeshCache(cachePath, key);
+		if (cached) {
+			std::cout << "Mapped " << path << " from " << cachePath << " in "
+				<< clock.getElapsedTime().asMicroseconds() / 1000.0 << " ms" << std::endl;
+			return std::move(*cached);
+		}
+	}
+
+	// No usable cache: a missing source is reported by the loader, like any other load error.
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> faces;
+	std::optional<ImportedScene> scene;
+	if (loader == MeshLoader::Assimp) {
+		scene = assimpLoad(path, vertices, faces, importFlags);
+	}
+	else {
+		objLoad(path, source, pool, vertices, faces);
+	}
+	double missesBefore = 0;
+	double missesAfter = 0;
+	if (optimize) {
+		missesBefore = averageCacheMissRatio(faces, vertices.size(), REPORTED_CACHE_SIZE);
+		optimizeVertexCache(faces, vertices.size());
+		optimizeVertexFetch(vertices, faces);
+		missesAfter = averageCacheMissRatio(faces, vertices.size(), REPORTED_CACHE_SIZE);
+	}
+	MeshBounds bounds = computeBounds(vertices);
+	// The loaders, the optimizer, and the simplifier all work on 32-bit indexes; they are narrowed
+	// only once the mesh is final.
+	AnyLoadedMesh mesh = vertices.size() <= MAX_16_BIT_VERTICES
+		? AnyLoadedMesh(LoadedMesh<uint16_t>(std::move(vertices), toIndexWidth<uint16_t>(faces), bounds))
+		: AnyLoadedMesh(LoadedMesh<uint32_t>(std::move(vertices), std::move(faces), bounds));
+	std::cout << "Loaded " << path << " with " << meshLoaderName(loader) << " in "
+		<< clock.getElapsedTime().asMicroseconds() / 1000.0 << " ms";
+	if (source.isOpen()) {
+		TRACE_SPAN("write cache");
+		bool written = std::visit([&](const auto& loaded) { return writeMeshCache(cachePath, key, loaded); }, mesh);
+		if (written) {
+			std::cout << ", cached in " << cachePath;
+		}
+		else {
+			std::cout << ", could not write a cache to " << cachePath;
+		}
+	}
+	std::cout << std::endl;
+	if (scene) {
+		std::cout << "  " << scene->meshes.size() << " meshes, " << scene->instances.size() << " instances";
+		if (scene->skippedPrimitives > 0) {
+			std::cout << ", " << scene->skippedPrimitives << " points and lines skipped";
+		}
+		std::cout << std::endl;
+		for (const ImportStepTime& step : scene->steps) {
+			std::cout << "  " << step.step << ": " << step.milliseconds << " ms" << std::endl;
+		}
+	}
+	if (optimize) {
+		std::cout << "  vertex cache: " << missesBefore << " misses per triangle before reordering, "
+			<< missesAfter << " after (FIFO cache of " << REPORTED_CACHE_SIZE << " vertices)" << std::endl;
+	}
+	return mesh;
+}
+
+// A plane in view space. A point p is on the inner side when
+// normal.x * p.x + normal.y * p.y + normal.z * p.z + distance >= 0.
+struct Plane {
+	Vertex3D normal;
+	float distance;
+};
+
+Plane normalizedPlane(float x, float y, float z, float distance) {
+	float length = std::sqrt(x * x + y * y + z * z);
+	return Plane(Vertex3D(x / length, y / length, z / length), distance / length);
+}
+
+// The six planes enclosing a frustum, with normals pointing inward. The camera looks down the
+// negative z axis, and our frusta are symmetric, so the left and bottom planes mirror the right
+// and top ones through the camera.
+std::array<Plane, 6> frustumPlanes(const Frustum& frustum) {
+	return std::array<Plane, 6>{
+		normalizedPlane(0, 0, -1, -frustum.near),
+		normalizedPlane(0, 0, 1, frustum.far),
+		normalizedPlane(frustum.near, 0, -frustum.right, 0),
+		normalizedPlane(-frustum.near, 0, -frustum.right, 0),
+		normalizedPlane(0, frustum.near, -frustum.top, 0),
+		normalizedPlane(0, -frustum.near, -frustum.top, 0)
+	};
+}
+
+// The object-level culling stage: the frustum's planes, and counts since the last profiler report.
+struct FrustumCulling {
+	std::array<Plane, 6> planes;
+	// Objects submitted for drawing, and how many of them were skipped.
+	size_t submitted{ 0 };
+	size_t culled{ 0 };
+};
+
+// True if an object with the given local bounds lies entirely outside one of the frustum's
+// planes once it is transformed to view space. `largestScale` is the largest of the object's
+// scale factors: rotating and moving it does not change the sphere's size, so that is how much
+// the sphere grows. The sphere is tested first because it is cheaper; objects that pass are
+// tested again with their box. Objects crossing a corner of the frustum can pass both tests
+// while still being outside, which only costs drawing them.
+bool isOutsideFrustum(const std::array<Plane, 6>& planes, const AffineTransform& localToView,
+	float largestScale, const MeshBounds& bounds) {
+	const auto& m = localToView.m;
+	Vertex3D center = transformVertex(localToView, bounds.center);
+	float radius = bounds.radius * largestScale;
+	// Where the box's local x, y, and z axes point in view space, scaled along with it.
+	Vertex3D axes[3] = {
+		Vertex3D(m[0][0], m[1][0], m[2][0]),
+		Vertex3D(m[0][1], m[1][1], m[2][1]),
+		Vertex3D(m[0][2], m[1][2], m[2][2])
+	};
+	float halfExtents[3] = { (bounds.max.x - bounds.min.x) / 2, (bounds.max.y - bounds.min.y) / 2, (bounds.max.z - bounds.min.z) / 2 };
+
+	for (const Plane& plane : planes) {
+		float centerDistance = plane.normal.x * center.x + plane.normal.y * center.y + plane.normal.z * center.z + plane.distance;
+		if (centerDistance < -radius) {
+			return true;
+		}
+		// How far the transformed box reaches toward the plane from its center.
+		float boxReach = 0;
+		for (int axis = 0; axis < 3; ++axis) {
+			boxReach += halfExtents[axis]
+				* std::abs(plane.normal.x * axes[axis].x + plane.normal.y * axes[axis].y + plane.normal.z * axes[axis].z);
+		}
+		if (centerDistance < -boxReach) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Counts an object submitted for drawing, and returns true if it is entirely outside the view,
+// so the caller can skip it before transforming a single vertex. Our camera stays at the origin,
+// so world space is view space.
+bool isCulled(FrustumCulling& frustumCulling, const sf::Vector3f& position, const sf::Vector3f& orientation,
+	const sf::Vector3f& scale, const MeshBounds& bounds) {
+	PROFILE_STAGE(ProfileStage::Clip);
+	TRACE_SPAN("frustum cull");
+	++frustumCulling.submitted;
+	AffineTransform localToView = localToWorldTransform(position, orientation, scale);
+	float largestScale = std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z) });
+	if (isOutsideFrustum(frustumCulling.planes, localToView, largestScale, bounds)) {
+		++frustumCulling.culled;
+		return true;
+	}
+	return false;
+}
+
+// One level of detail as the draw functions see it: the loaded mesh itself, or one of the
+// MeshLevels simplified from it (see mesh_simplifier.h), with its unique edges for --edges. Every
+// level's indexes have the width the loaded mesh was given.
+template <typename Index>
+struct LodLevel {
+	std::span<const Vertex3D> vertices;
+	std::span<const Index> faces;
+	std::span<const Index> edges;
+	// How far the level strays from the original surface, as a fraction of the radius of the
+	// sphere around the mesh's bounding box.
+	float error;
+};
+
+// A mesh's levels of detail, finest first, and the screen-space error allowed when picking one.
+template <typename Index>
+struct LevelsOfDetail {
+	std::vector<LodLevel<Index>> levels;
+	// --lod-pixels: the most a level's error may show on screen, in pixels.
+	float maxPixelError{ 1.0f };
+	// How many times each level was drawn since the last profiler report.
+	std::vector<size_t> draws;
+};
+
+// Picks the coarsest level whose error stays within lods.maxPixelError once projected: the error
+// scales with the projected radius of the sphere around the object's bounding box, which shrinks
+// with distance. Objects with the camera inside that sphere always get the finest level.
+template <typename Index>
+size_t selectLevel(LevelsOfDetail<Index>& lods, const sf::View& viewport, const Frustum& frustum,
+	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale, const MeshBounds& bounds) {
+	AffineTransform localToView = localToWorldTransform(position, orientation, scale);
+	Vertex3D center = transformVertex(localToView, bounds.center);
+	float largestScale = std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z) });
+	float dx = bounds.max.x - bounds.min.x;
+	float dy = bounds.max.y - bounds.min.y;
+	float dz = bounds.max.z - bounds.min.z;
+	float radius = std::sqrt(dx * dx + dy * dy + dz * dz) / 2 * largestScale;
+	float distance = std::sqrt(center.x * center.x + center.y * center.y + center.z * center.z);
+
+	size_t level = 0;
+	if (distance > radius) {
+		// At the near plane, `top` view-space units fill half the viewport's height.
+		float projectedRadius = radius / distance * frustum.near / frustum.top * viewport.getSize().y / 2;
+		while (level + 1 < lods.levels.size() && lods.levels[level + 1].error * projectedRadius <= lods.maxPixelError) {
+			++level;
+		}
+	}
+	++lods.draws[level];
+	return level;
+}
+
 // Transform from view coordinates to clip coordinates.
 Vertex3D viewToClip(const Frustum& frustum, const Vertex3D& view) {
 	float xp = view.x * -frustum.near / view.z;
 	float yp = view.y * -frustum.near / view.z;
 	float xClip = xp / frustum.right;
 	float yClip = yp / frustum.top;
-	return Vertex3D(xClip, yClip, 0);
+	// Depth goes from -1 at the near plane to 1 at the far plane, the same as OpenGL's
+	// perspective projection after the divide by w. It is not linear in view z: most of the
+	// range is spent close to the near plane, where precision matters most.
+	float zClip = (frustum.far + frustum.near) / (frustum.far - frustum.near)
+		+ 2 * frustum.far * frustum.near / ((frustum.far - frustum.near) * view.z);
+	return Vertex3D(xClip, yClip, zClip);
+}
+
+// Linear interpolate from clip coordinates to screen coordinates. Depth passes through
+// unchanged, for the depth buffer. Coordinates may be negative or past the edge of the screen,
+// for triangles that reach into the guard band (see below).
+ScreenVertex clipToScreen(const sf::View& viewport, const Vertex3D& clip) {
+	int32_t xs = static_cast<int32_t>(viewport.getSize().x * (clip.x + 1) / 2.0);
+	int32_t ys = static_cast<int32_t>(viewport.getSize().y - viewport.getSize().y * (clip.y + 1) / 2.0);
+	return ScreenVertex(sf::Vector2i(xs, ys), clip.z);
+}
+
+// A vertex in homogeneous clip space: viewToClip's result before the divide by w, where w is the
+// distance in front of the camera. Lines stay lines in this space, so triangles can be clipped
+// here and still interpolate correctly. A vertex behind the camera has a negative w, and
+// dividing by it would flip its position to the opposite side of the screen.
+struct HomogeneousVertex {
+	float x;
+	float y;
+	float z;
+	float w;
+};
+
+// Transform from view coordinates to homogeneous clip coordinates.
+HomogeneousVertex viewToHomogeneous(const Frustum& frustum, const Vertex3D& view) {
+	float depthScale = -(frustum.far + frustum.near) / (frustum.far - frustum.near);
+	float depthOffset = -2 * frustum.far * frustum.near / (frustum.far - frustum.near);
+	return HomogeneousVertex(view.x * frustum.near / frustum.right, view.y * frustum.near / frustum.top,
+		depthScale * view.z + depthOffset, -view.z);
+}
+
+// The divide by w, giving the same coordinates as viewToClip.
+Vertex3D perspectiveDivide(const HomogeneousVertex& vertex) {
+	return Vertex3D(vertex.x / vertex.w, vertex.y / vertex.w, vertex.z / vertex.w);
+}
+
+HomogeneousVertex interpolate(const HomogeneousVertex& from, const HomogeneousVertex& to, float t) {
+	return HomogeneousVertex(from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t,
+		from.z + (to.z - from.z) * t, from.w + (to.w - from.w) * t);
+}
+
+// Triangles are clipped against the near plane, so nothing behind the camera is ever divided by
+// w. They are not clipped against the edges of the screen: the rasterizer already limits itself
+// to the pixels on screen, so a triangle hanging off the edge costs nothing extra. Only vertices
+// more than GUARD_BAND times the half-width (or half-height) of the screen from its center are
+// clipped to that distance, which keeps every screen coordinate within a few screen sizes of the
+// viewport, far from integer overflow. A clipped triangle can still span up to four screen widths
+// (or heights). The rasterizer's 8-wide path only takes triangles spanning fewer than
+// SIMD_SPAN_LIMIT (8192) pixels, so on viewports larger than 2048 pixels the biggest clipped
+// triangles are filled by its scalar path instead, which draws the same pixels more slowly.
+const float GUARD_BAND = 4.0f;
+const int CLIP_PLANE_COUNT = 5;
+
+// Positive for vertices on the visible side of the plane, negative outside it, and linear along
+// any edge, so the zero crossing is where the edge meets the plane.
+float clipPlaneDistance(const HomogeneousVertex& vertex, int plane) {
+	switch (plane) {
+	case 0:
+		return vertex.z + vertex.w; // Near: z / w >= -1.
+	case 1:
+		return GUARD_BAND * vertex.w + vertex.x;
+	case 2:
+		return GUARD_BAND * vertex.w - vertex.x;
+	case 3:
+		return GUARD_BAND * vertex.w + vertex.y;
+	default:
+		return GUARD_BAND * vertex.w - vertex.y;
+	}
+}
+
+// One bit per plane the vertex is outside of, in clipPlaneDistance's order.
+uint8_t clipOutcode(const HomogeneousVertex& vertex) {
+	uint8_t outcode = 0;
+	for (int plane = 0; plane < CLIP_PLANE_COUNT; ++plane) {
+		if (clipPlaneDistance(vertex, plane) < 0) {
+			outcode |= 1 << plane;
+		}
+	}
+	return outcode;
+}
+
+// Each plane can add at most one corner to a convex polygon.
+const size_t MAX_CLIPPED_CORNERS = 3 + CLIP_PLANE_COUNT;
+
+// Sutherland-Hodgman: clips a polygon against each plane in the outcode mask in turn, keeping the
+// corners inside the plane and adding one where each edge crosses it. Returns the number of
+// corners left, which is 0 if the polygon was entirely outside one of the planes.
+size_t clipPolygon(std::array<HomogeneousVertex, MAX_CLIPPED_CORNERS>& polygon, size_t count, uint8_t planes) {
+	std::array<HomogeneousVertex, MAX_CLIPPED_CORNERS> clipped;
+	for (int plane = 0; plane < CLIP_PLANE_COUNT && count > 0; ++plane) {
+		if ((planes & (1 << plane)) == 0) {
+			continue;
+		}
+		size_t kept = 0;
+		for (size_t i = 0; i < count; ++i) {
+			const HomogeneousVertex& from = polygon[i];
+			const HomogeneousVertex& to = polygon[(i + 1) % count];
+			float fromDistance = clipPlaneDistance(from, plane);
+			float toDistance = clipPlaneDistance(to, plane);
+			if (fromDistance >= 0) {
+				clipped[kept++] = from;
+			}
+			if ((fromDistance >= 0) != (toDistance >= 0)) {
+				clipped[kept++] = interpolate(from, to, fromDistance / (fromDistance - toDistance));
+			}
+		}
+		std::copy(clipped.begin(), clipped.begin() + kept, polygon.begin());
+		count = kept;
+	}
+	return count;
+}
+
+// The Liang-Barsky version of clipPolygon, for a single line segment: shortens the segment to the
+// part inside every plane in the mask. Returns false if none of it is.
+bool clipSegment(HomogeneousVertex& start, HomogeneousVertex& end, uint8_t planes) {
+	float enter = 0.0f;
+	float exit = 1.0f;
+	for (int plane = 0; plane < CLIP_PLANE_COUNT; ++plane) {
+		if ((planes & (1 << plane)) == 0) {
+			continue;
+		}
+		float startDistance = clipPlaneDistance(start, plane);
+		float endDistance = clipPlaneDistance(end, plane);
+		if (startDistance < 0 && endDistance < 0) {
+			return false;
+		}
+		if (startDistance < 0) {
+			enter = std::max(enter, startDistance / (startDistance - endDistance));
+		}
+		else if (endDistance < 0) {
+			exit = std::min(exit, startDistance / (startDistance - endDistance));
+		}
+	}
+	if (enter > exit) {
+		return false;
+	}
+	HomogeneousVertex clippedStart = interpolate(start, end, enter);
+	end = interpolate(start, end, exit);
+	start = clippedStart;
+	return true;
+}
+
+// Setup output for one block of faces in setupFaces.
+struct FaceBlock {
+	size_t kept{ 0 };
+	size_t culled{ 0 };
+	size_t clippedFaces{ 0 };
+	// Pieces of faces that crossed a clip plane. Clipping can turn one triangle into several, so
+	// they do not always fit in the block's own slice of the output.
+	std::vector<ScreenTriangle> clipped;
+};
+
+// Screen-space positions for every vertex of the mesh being drawn, and the triangles assembled
+// from them. drawMesh fills it once per call, so vertices shared by several faces are only
+// transformed once. It is kept between calls so the buffers do not need to be reallocated every
+// frame.
+struct VertexCache {
+	std::vector<ScreenVertex> screen;
+	// The same vertices before the perspective divide, and which clip planes each is outside of.
+	// The screen position is only valid for vertices with an outcode of 0.
+	std::vector<HomogeneousVertex> homogeneous;
+	std::vector<uint8_t> outcodes;
+	std::vector<ScreenTriangle> triangles;
+	// The triangles of each block of faces, while setupFaces runs.
+	std::vector<FaceBlock> blocks;
+	// Where setupFaces joins the blocks when some of them clipped triangles.
+	std::vector<ScreenTriangle> joined;
+	// Running totals since the last profiler report.
+	size_t verticesTransformed{ 0 };
+	size_t facesClipped{ 0 };
+	// Triangles that setupFaces handed on to be drawn, after culling and clipping.
+	size_t trianglesDrawn{ 0 };
+	// Lines that drawMeshEdges drew, after clipping. --edges draws no triangles.
+	size_t linesDrawn{ 0 };
+};
+
+// The smallest slices of work handed to a worker thread. Work that fits in one chunk runs on the
+// calling thread without any synchronization: the bunny's 2503 vertices are transformed that way,
+// but its 4968 faces are set up as two chunks.
+const size_t VERTEX_CHUNK_SIZE = 4096;
+const size_t FACE_CHUNK_SIZE = 4096;
+
+// Transforms every vertex of a mesh to screen coordinates, storing them in the cache. Large
+// meshes are split into chunks across the pool's threads; each chunk writes only its own slice
+// of the cache, so the result is identical no matter how the chunks were scheduled.
+void transformVertices(ThreadPool& pool, const sf::View& viewport, const Frustum& frustum,
+	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale,
+	std::span<const Vertex3D> vertices, VertexCache& cache) {
+	PROFILE_STAGE(ProfileStage::Transform);
+	TRACE_SPAN("transform");
+	// Compile the object's transform once; each vertex then only costs one matrix multiply on
+	// its way to world space.
+	AffineTransform transform = localToWorldTransform(position, orientation, scale);
+
+	cache.screen.resize(vertices.size());
+	cache.homogeneous.resize(vertices.size());
+	cache.outcodes.resize(vertices.size());
+	pool.parallelFor(vertices.size(), VERTEX_CHUNK_SIZE, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			auto world = transformVertex(transform, vertices[i]);
+			// Debug builds check the fast path against the step-by-step function.
+			assert(matchesWithinTolerance(world, localToWorld(position, orientation, scale, vertices[i])));
+			HomogeneousVertex homogeneous = viewToHomogeneous(frustum, world);
+			cache.homogeneous[i] = homogeneous;
+			cache.outcodes[i] = clipOutcode(homogeneous);
+			if (cache.outcodes[i] == 0) {
+				auto clip = perspectiveDivide(homogeneous);
+				assert(matchesWithinTolerance(clip, viewToClip(frustum, world)));
+				cache.screen[i] = clipToScreen(viewport, clip);
+			}
+		}
+	});
+	cache.verticesTransformed += vertices.size();
+}
+
+// Clips a face that crosses the near plane or the guard band, and appends what is left of it to
+// the output as a fan of triangles. Returns false if the face was culled as a back face.
+bool clipFace(const sf::View& viewport, const HomogeneousVertex& a, const HomogeneousVertex& b,
+	const HomogeneousVertex& c, uint8_t planes, const BackFaceCulling& culling, std::vector<ScreenTriangle>& output) {
+	std::array<HomogeneousVertex, MAX_CLIPPED_CORNERS> polygon = { a, b, c };
+	size_t count = clipPolygon(polygon, 3, planes);
+	if (count < 3) {
+		return true;
+	}
+	std::array<ScreenVertex, MAX_CLIPPED_CORNERS> corners;
+	for (size_t i = 0; i < count; ++i) {
+		corners[i] = clipToScreen(viewport, perspectiveDivide(polygon[i]));
+	}
+	// Clipping keeps the winding of the face, so the whole polygon faces one way.
+	if (culling.enabled) {
+		int64_t area = 0;
+		for (size_t i = 1; i + 1 < count; ++i) {
+			area += screenSignedArea(corners[0].position, corners[i].position, corners[i + 1].position);
+		}
+		bool backFacing = culling.frontFace == FrontFace::Clockwise ? area <= 0 : area >= 0;
+		if (backFacing) {
+			return false;
+		}
+	}
+	for (size_t i = 1; i + 1 < count; ++i) {
+		output.push_back(ScreenTriangle{ corners[0], corners[i], corners[i + 1] });
+	}
+	return true;
+}
+
+// Assembles the transformed corners of each face into a screen-space triangle, in face order,
+// split across the pool's threads the same way as transformVertices. When culling is enabled,
+// back faces are dropped here, so no later stage spends any time on them. Faces entirely behind
+// the camera are dropped too, and faces that cross the near plane are clipped to it. Index is the
+// width of the face indexes (see LoadedMesh).
+template <typename Index>
+void setupFaces(ThreadPool& pool, const sf::View& viewport, std::span<const Index> faces,
+	BackFaceCulling& culling, VertexCache& cache) {
+	PROFILE_STAGE(ProfileStage::Clip);
+	TRACE_SPAN("setup faces");
+	size_t faceCount = faces.size() / VERTICES_PER_FACE;
+	cache.triangles.resize(faceCount);
+
+	// Faces are split into fixed blocks, and each block packs its surviving triangles at the
+	// start of its own slice of the output. That needs no synchronization between threads, and
+	// the blocks are then moved together in order, so the result does not depend on scheduling.
+	size_t blockCount = (faceCount + FACE_CHUNK_SIZE - 1) / FACE_CHUNK_SIZE;
+	cache.blocks.resize(blockCount);
+	pool.parallelFor(blockCount, 1, [&](size_t beginBlock, size_t endBlock) {
+		for (size_t block = beginBlock; block < endBlock; ++block) {
+			size_t begin = block * FACE_CHUNK_SIZE;
+			size_t end = std::min(begin + FACE_CHUNK_SIZE, faceCount);
+			FaceBlock& output = cache.blocks[block];
+			output.culled = 0;
+			output.clippedFaces = 0;
+			output.clipped.clear();
+			size_t kept = begin;
+			for (size_t i = begin; i < end; ++i) {
+				Index a = faces[i * VERTICES_PER_FACE];
+				Index b = faces[i * VERTICES_PER_FACE + 1];
+				Index c = faces[i * VERTICES_PER_FACE + 2];
+				uint8_t crossed = cache.outcodes[a] | cache.outcodes[b] | cache.outcodes[c];
+				if (crossed != 0) {
+					// Entirely outside one plane: nothing to clip, the face is simply not visible.
+					if ((cache.outcodes[a] & cache.outcodes[b] & cache.outcodes[c]) != 0) {
+						continue;
+					}
+					++output.clippedFaces;
+					if (!clipFace(viewport, cache.homogeneous[a], cache.homogeneous[b], cache.homogeneous[c],
+						crossed, culling, output.clipped)) {
+						++output.culled;
+					}
+					continue;
+				}
+				ScreenTriangle triangle = ScreenTriangle{ cache.screen[a], cache.screen[b], cache.screen[c] };
+				if (culling.enabled
+					&& isBackFacing(triangle.a.position, triangle.b.position, triangle.c.position, culling.frontFace)) {
+					++output.culled;
+					continue;
+				}
+				cache.triangles[kept++] = triangle;
+			}
+			output.kept = kept - begin;
+		}
+	});
+
+	bool anyClipped = std::any_of(cache.blocks.begin(), cache.blocks.end(),
+		[](const FaceBlock& block) { return !block.clipped.empty(); });
+	size_t total = 0;
+	size_t culled = 0;
+	if (!anyClipped) {
+		// The usual case: every block fits in its own slice, so they can be moved together in place.
+		for (size_t block = 0; block < blockCount; ++block) {
+			auto first = cache.triangles.begin() + block * FACE_CHUNK_SIZE;
+			std::copy(first, first + cache.blocks[block].kept, cache.triangles.begin() + total);
+			total += cache.blocks[block].kept;
+			culled += cache.blocks[block].culled;
+		}
+		cache.triangles.resize(total);
+	}
+	else {
+		// Each block's clipped pieces follow its other triangles, keeping the output in face
+		// order block by block.
+		cache.joined.clear();
+		for (size_t block = 0; block < blockCount; ++block) {
+			auto first = cache.triangles.begin() + block * FACE_CHUNK_SIZE;
+			cache.joined.insert(cache.joined.end(), first, first + cache.blocks[block].kept);
+			cache.joined.insert(cache.joined.end(), cache.blocks[block].clipped.begin(), cache.blocks[block].clipped.end());
+			culled += cache.blocks[block].culled;
+		}
+		std::swap(cache.triangles, cache.joined);
+	}
+	for (const FaceBlock& block : cache.blocks) {
+		cache.facesClipped += block.clippedFaces;
+	}
+	culling.submitted += faceCount;
+	culling.culled += culled;
+	cache.trianglesDrawn += cache.triangles.size();
 }
 
-// Linear interpolate from clip coordinates to screen coordinates.
-sf::Vector2i clipToScreen(const sf::View& viewport, const Vertex3D& clip) {
-	int32_t xs = static_cast<uint32_t>(viewport.getSize().x * (clip.x + 1) / 2.0);
-	int32_t ys = static_cast<uint32_t>(viewport.getSize().y - viewport.getSize().y * (clip.y + 1) / 2.0);
-	return sf::Vector2i(xs, ys);
+// How drawMesh hands its lines to SFML. Chosen on the command line, so the paths can be
+// benchmarked against each other with the profiler.
+enum class SubmissionMode {
+	Immediate,  // --immediate: one window.draw call per line.
+	Batched,    // --batched: one window.draw call per drawMesh, from a retained vertex array.
+	Framebuffer // --framebuffer (default): rasterize into our framebuffer, present once per frame.
+};
+
+struct Options {
+	SubmissionMode submission{ SubmissionMode::Framebuffer };
+	// --edges: draw wireframes from each mesh's unique edge list instead of its faces.
+	bool uniqueEdges{ false };
+	// --fill: draw filled triangles with the tile-binned rasterizer instead of wireframes.
+	// Only the framebuffer can be filled.
+	bool fill{ false };
+	// --no-depth: fill without the depth buffer, so triangles simply cover each other in face
+	// order. Compare its overdraw with the default's.
+	bool depthTest{ true };
+	// --threads N: how many threads transform vertices and set up faces. 0 means one per
+	// hardware thread.
+	size_t threads{ 0 };
+	// --cull: drop triangles facing away from the camera before drawing them.
+	bool cull{ false };
+	// --front-face cw|ccw: the winding of front faces. The bunny's are counterclockwise.
+	FrontFace frontFace{ FrontFace::CounterClockwise };
+	// --benchmark-threads: time the vertex stages with 1 to N threads on a large mesh, then exit.
+	bool benchmarkThreads{ false };
+	// --benchmark-raster: time the triangle fill paths on small, medium, and large triangles, then exit.
+	bool benchmarkRaster{ false };
+	// --loader assimp|obj: how to read the bunny when it has no usable cache.
+	MeshLoader loader{ MeshLoader::Assimp };
+	// --import full|minimal: Assimp's post-processing, either its MaxQuality preset or just
+	// triangulating and joining identical vertices (see scene_import.h).
+	unsigned int importFlags{ IMPORT_FULL };
+	// --optimize: reorder the bunny's triangles and vertices for locality when it is loaded.
+	bool optimize{ false };
+	// --lod: simplify the bunny into a chain of levels of detail when it is loaded, and draw the
+	// coarsest one that looks the same at its size on screen.
+	bool lod{ false };
+	// --lod-errors E1,E2,...: the most each level after the first may stray from the original
+	// surface, as fractions of the bunny's size (see mesh_simplifier.h). One level is built per error.
+	std::vector<float> lodErrors{ 0.004f, 0.008f, 0.016f, 0.032f };
+	// --lod-pixels P: the most a level's error may show on screen, in pixels.
+	float lodPixels{ 1.0f };
+	// --benchmark-load: time Assimp against the OBJ parser on the bunny and a large OBJ, then exit.
+	bool benchmarkLoad{ false };
+	// --headless WxH, --frames N, --output FILE: render into the framebuffer without a window.
+	HeadlessOptions headless;
+	// --trace FILE, --trace-frames N: record a timeline of loading and the first frames.
+	TraceOptions trace;
+};
+
+// Parses a whole string as a finite number greater than 0.
+bool parsePositiveFloat(std::string_view text, float& value) {
+	auto [end, error] { std::from_chars(text.data(), text.data() + text.size(), value) };
+	return error == std::errc{} && end == text.data() + text.size() && std::isfinite(value) && value > 0;
 }
 
-void drawMesh(sf::RenderWindow& window, const Frustum& frustum,
+// --threads is limited to this many threads per hardware thread.
+const size_t MAX_THREADS_PER_HARDWARE_THREAD{ 4 };
+
+Options parseOptions(int argc, char* argv[]) {
+	Options options{};
+	for (int i{ 1 }; i < argc; ++i) {
+		std::string_view arg{ argv[i] };
+		if (arg == "--immediate") {
+			options.submission = SubmissionMode::Immediate;
+		}
+		else if (arg == "--batched") {
+			options.submission = SubmissionMode::Batched;
+		}
+		else if (arg == "--framebuffer") {
+			options.submission = SubmissionMode::Framebuffer;
+		}
+		else if (arg == "--edges") {
+			options.uniqueEdges = true;
+		}
+		else if (arg == "--fill") {
+			options.fill = true;
+		}
+		else if (arg == "--no-depth") {
+			options.depthTest = false;
+		}
+		else if (arg == "--cull") {
+			options.cull = true;
+		}
+		else if (arg == "--front-face" && i + 1 < argc && std::string_view(argv[i + 1]) == "cw") {
+			options.frontFace = FrontFace::Clockwise;
+			++i;
+		}
+		else if (arg == "--front-face" && i + 1 < argc && std::string_view(argv[i + 1]) == "ccw") {
+			options.frontFace = FrontFace::CounterClockwise;
+			++i;
+		}
+		else if (arg == "--threads" && i + 1 < argc) {
+			std::string_view value{ argv[++i] };
+			auto [end, error] { std::from_chars(value.data(), value.data() + value.size(), options.threads) };
+			if (error != std::errc{} || end != value.data() + value.size()) {
+				std::cout << "--threads needs a number of threads, or 0 for one per hardware thread, not " << value << std::endl;
+				exit(1);
+			}
+			// More threads than this only adds scheduling overhead, and a typo like 100000 would
+			// otherwise start that many.
+			size_t maxThreads{ MAX_THREADS_PER_HARDWARE_THREAD * std::max(1u, std::thread::hardware_concurrency()) };
+			if (options.threads > maxThreads) {
+				std::cout << "--threads " << options.threads << " is more than " << maxThreads << ", using " << maxThreads << std::endl;
+				options.threads = maxThreads;
+			}
+		}
+		else if (arg == "--benchmark-threads") {
+			options.benchmarkThreads = true;
+		}
+		else if (arg == "--benchmark-raster") {
+			options.benchmarkRaster = true;
+		}
+		else if (arg == "--loader" && i + 1 < argc && std::string_view(argv[i + 1]) == "assimp") {
+			options.loader = MeshLoader::Assimp;
+			++i;
+		}
+		else if (arg == "--loader" && i + 1 < argc && std::string_view(argv[i + 1]) == "obj") {
+			options.loader = MeshLoader::Obj;
+			++i;
+		}
+		else if (arg == "--import" && i + 1 < argc && std::string_view(argv[i + 1]) == "full") {
+			options.importFlags = IMPORT_FULL;
+			++i;
+		}
+		else if (arg == "--import" && i + 1 < argc && std::string_view(argv[i + 1]) == "minimal") {
+			options.importFlags = IMPORT_MINIMAL;
+			++i;
+		}
+		else if (arg == "--optimize") {
+			options.optimize = true;
+		}
+		else if (arg == "--lod") {
+			options.lod = true;
+		}
+		else if (arg == "--lod-errors" && i + 1 < argc) {
+			// selectLevel walks the levels from finest to coarsest, so the errors must increase.
+			options.lodErrors.clear();
+			std::string_view value{ argv[++i] };
+			std::string_view list{ value };
+			while (true) {
+				size_t comma{ list.find(',') };
+				float error{ 0 };
+				if (!parsePositiveFloat(list.substr(0, comma), error)
+					|| (!options.lodErrors.empty() && error <= options.lodErrors.back())) {
+					std::cout << "--lod-errors needs increasing positive numbers separated by commas, not " << value << std::endl;
+					exit(1);
+				}
+				options.lodErrors.push_back(error);
+				if (comma == std::string_view::npos) {
+					break;
+				}
+				list.remove_prefix(comma + 1);
+			}
+		}
+		else if (arg == "--lod-pixels" && i + 1 < argc) {
+			std::string_view value{ argv[++i] };
+			if (!parsePositiveFloat(value, options.lodPixels)) {
+				std::cout << "--lod-pixels needs a positive number, not " << value << std::endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--benchmark-load") {
+			options.benchmarkLoad = true;
+		}
+		else if (parseHeadlessOption(argc, argv, i, options.headless)) {
+			continue;
+		}
+		else if (parseTraceOption(argc, argv, i, options.trace)) {
+			continue;
+		}
+		else {
+			std::cout << "Unknown option " << arg << std::endl;
+			std::cout << "Usage: " << argv[0] << " [--immediate | --batched | --framebuffer] [--edges | --fill [--no-depth]] [--cull [--front-face cw|ccw]]"
+				<< " [--threads N] [--benchmark-threads] [--benchmark-raster]"
+				<< " [--loader assimp|obj] [--import full|minimal] [--optimize] [--lod [--lod-errors E1,E2,...] [--lod-pixels P]] [--benchmark-load] " << HEADLESS_USAGE << " " << TRACE_USAGE << std::endl;
+			exit(1);
+		}
+	}
+	if (options.fill && options.submission != SubmissionMode::Framebuffer) {
+		std::cout << "--fill can only be used with --framebuffer" << std::endl;
+		exit(1);
+	}
+	if (options.cull && options.uniqueEdges) {
+		// An edge is shared by a front face and a back face on the silhouette, so there is no
+		// way to cull an edge list.
+		std::cout << "--cull cannot be used with --edges" << std::endl;
+		exit(1);
+	}
+	if (options.headless.enabled && options.submission != SubmissionMode::Framebuffer) {
+		// The other modes draw through the window.
+		std::cout << "--headless can only be used with --framebuffer" << std::endl;
+		exit(1);
+	}
+	if (options.headless.frameOptionsGiven && !options.headless.enabled) {
+		std::cout << "--frames and --output can only be used with --headless" << std::endl;
+		exit(1);
+	}
+	return options;
+}
+
+// RenderTarget is the sf::RenderWindow itself, a LineBatch that collects the lines for one
+// window.draw call, or a Framebuffer that we draw into. Index is the width of the face indexes.
+template <typename RenderTarget, typename Index>
+void drawMesh(RenderTarget& target, ThreadPool& pool, VertexCache& cache, BackFaceCulling& culling,
+	FrustumCulling& frustumCulling, const Frustum& frustum,
 	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale,
-	const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces, sf::Color color) {
-	// Loop through the list of face indexes, 3 at a time.
-	// Pull each vertex out of the vertices list.
-	// Transform them from clip coordinates to screen coordinates.
-	// Draw a triangle connecting them.
-	for (size_t i = 0; i < faces.size(); i = i + 3) {
-		auto& vertexA = vertices[faces[i]];
-		auto& vertexB = vertices[faces[i + 1]];
-		auto& vertexC = vertices[faces[i + 2]];
+	std::span<const Vertex3D> vertices, std::span<const Index> faces, const MeshBounds& bounds, sf::Color color) {
+	TRACE_SPAN("drawMesh");
+	if (isCulled(frustumCulling, position, orientation, scale, bounds)) {
+		return;
+	}
+	// Transform each vertex once, then assemble the faces into screen-space triangles and draw
+	// each of them.
+	transformVertices(pool, target.getView(), frustum, position, orientation, scale, vertices, cache);
+	setupFaces(pool, target.getView(), faces, culling, cache);
+	PROFILE_STAGE(ProfileStage::Raster);
+	TRACE_SPAN("raster");
+	for (const ScreenTriangle& triangle : cache.triangles) {
+		drawTriangle(target, triangle.a.position, triangle.b.position, triangle.c.position, color);
+	}
 
-		auto worldA = localToWorld(position, orientation, scale, vertexA);
-		auto worldB = localToWorld(position, orientation, scale, vertexB);
-		auto worldC = localToWorld(position, orientation, scale, vertexC);
+	// Batched lines reach the window in a single draw call, once the whole mesh is collected.
+	if constexpr (std::is_same_v<RenderTarget, LineBatch>) {
+		target.flush();
+	}
+}
 
-		auto clipA = viewToClip(frustum, worldA);
-		auto clipB = viewToClip(frustum, worldB);
-		auto clipC = viewToClip(frustum, worldC);
+// A wireframe variant of drawMesh that walks a unique edge list (see extractEdges) instead of
+// the faces, so edges shared by two faces are only drawn once.
+template <typename RenderTarget, typename Index>
+void drawMeshEdges(RenderTarget& target, ThreadPool& pool, VertexCache& cache,
+	FrustumCulling& frustumCulling, const Frustum& frustum,
+	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale,
+	std::span<const Vertex3D> vertices, std::span<const Index> edges, const MeshBounds& bounds, sf::Color color) {
+	TRACE_SPAN("drawMeshEdges");
+	if (isCulled(frustumCulling, position, orientation, scale, bounds)) {
+		return;
+	}
+	transformVertices(pool, target.getView(), frustum, position, orientation, scale, vertices, cache);
+	PROFILE_STAGE(ProfileStage::Raster);
+	TRACE_SPAN("raster");
+	for (size_t i = 0; i < edges.size(); i = i + 2) {
+		Index start = edges[i];
+		Index end = edges[i + 1];
+		if ((cache.outcodes[start] | cache.outcodes[end]) == 0) {
+			drawLine(target, cache.screen[start].position, cache.screen[end].position, color);
+			++cache.linesDrawn;
+			continue;
+		}
+		// Edges that cross the near plane or the guard band are clipped the same way as faces.
+		HomogeneousVertex clippedStart = cache.homogeneous[start];
+		HomogeneousVertex clippedEnd = cache.homogeneous[end];
+		if (clipSegment(clippedStart, clippedEnd, cache.outcodes[start] | cache.outcodes[end])) {
+			drawLine(target, clipToScreen(target.getView(), perspectiveDivide(clippedStart)).position,
+				clipToScreen(target.getView(), perspectiveDivide(clippedEnd)).position, color);
+			++cache.linesDrawn;
+		}
+	}
 
-		auto viewport = window.getView();
-		auto screenA = clipToScreen(viewport, clipA);
-		auto screenB = clipToScreen(viewport, clipB);
-		auto screenC = clipToScreen(viewport, clipC);
+	if constexpr (std::is_same_v<RenderTarget, LineBatch>) {
+		target.flush();
+	}
+}
 
 
-		drawTriangle(window, 
-			sf::Vector2i(screenA.x, screenA.y),
-			sf::Vector2i(screenB.x, screenB.y),
-			sf::Vector2i(screenC.x, screenC.y),
-			color
-		);
+// Draws a mesh as filled triangles with the tile-binned rasterizer, sharing the transform and
+// face setup stages with drawMesh. With a depth buffer only the nearest surfaces are kept; with
+// nullptr, triangles cover each other in face order.
+template <typename Index>
+void fillMesh(Framebuffer& framebuffer, DepthBuffer* depthBuffer, TileRasterizer& rasterizer, ThreadPool& pool,
+	VertexCache& cache, BackFaceCulling& culling, FrustumCulling& frustumCulling, const Frustum& frustum,
+	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale,
+	std::span<const Vertex3D> vertices, std::span<const Index> faces, const MeshBounds& bounds, sf::Color color) {
+	TRACE_SPAN("fillMesh");
+	if (isCulled(frustumCulling, position, orientation, scale, bounds)) {
+		return;
+	}
+	transformVertices(pool, framebuffer.getView(), frustum, position, orientation, scale, vertices, cache);
+	setupFaces(pool, framebuffer.getView(), faces, culling, cache);
+	PROFILE_STAGE(ProfileStage::Raster);
+	TRACE_SPAN("raster");
+	if (depthBuffer != nullptr) {
+		rasterizer.draw(framebuffer, *depthBuffer, pool, cache.triangles, color);
+	}
+	else {
+		rasterizer.draw(framebuffer, pool, cache.triangles, color);
 	}
 }
 
+// Computes the right and top of a frustum from its vertical field of view, in degrees, and the
+// aspect ratio of the screen.
+Frustum makeFrustum(float fovy, float ratio, float near, float far) {
+	float t = near * tan((fovy * M_PI / 180.0f) / 2);
+	float r = t * ratio;
+	return Frustum(near, far, r, t);
+}
 
-int main() {
-	sf::RenderWindow window{ sf::VideoMode::getFullscreenModes().at(0), "SFML Demo" };
-	sf::Clock c;
+// Builds a unit sphere out of `rings` bands of `segments` quads each: about 2 * rings * segments
+// triangles, for benchmarks that need a mesh far bigger than the bunny.
+void makeSphere(size_t rings, size_t segments, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces) {
+	vertices.reserve((rings + 1) * (segments + 1));
+	for (size_t ring = 0; ring <= rings; ++ring) {
+		float phi = static_cast<float>(M_PI * ring / rings);
+		for (size_t segment = 0; segment <= segments; ++segment) {
+			float theta = static_cast<float>(2 * M_PI * segment / segments);
+			vertices.push_back(Vertex3D(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)));
+		}
+	}
 
-	std::vector<Vertex3D> bunnyVertices;
-	std::vector<uint32_t> bunnyFaces;
-	assimpLoad("models/bunny.obj", bunnyVertices, bunnyFaces);
+	faces.reserve(rings * segments * 2 * VERTICES_PER_FACE);
+	for (size_t ring = 0; ring < rings; ++ring) {
+		for (size_t segment = 0; segment < segments; ++segment) {
+			uint32_t topLeft = static_cast<uint32_t>(ring * (segments + 1) + segment);
+			uint32_t bottomLeft = static_cast<uint32_t>(topLeft + segments + 1);
+			faces.insert(faces.end(), { topLeft, bottomLeft, topLeft + 1 });
+			faces.insert(faces.end(), { topLeft + 1, bottomLeft, bottomLeft + 1 });
+		}
+	}
+}
+
+// Times the vertex transform and face setup stages on a 2-million-triangle sphere with 1, 2, 4,
+// ... threads, up to one per hardware thread, and checks that every thread count produces exactly
+// the same triangles.
+void benchmarkThreads() {
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> faces;
+	makeSphere(1000, 1000, vertices, faces);
+	std::cout << faces.size() / VERTICES_PER_FACE << " triangles, " << vertices.size() << " vertices" << std::endl;
+
+	sf::View viewport = sf::View(sf::FloatRect({ 0, 0 }, { 1920, 1080 }));
+	Frustum frustum = makeFrustum(60, 1920.0f / 1080.0f, 0.1f, 100.0f);
+	sf::Vector3f position = sf::Vector3f(0, 0, -3);
+	sf::Vector3f orientation = sf::Vector3f(0.3f, 0.5f, 0);
+	sf::Vector3f scale = sf::Vector3f(1, 1, 1);
+
+	const int REPETITIONS = 10;
+	size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<ScreenTriangle> reference;
+	double singleThreadMs = 0;
+	for (size_t threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+		ThreadPool pool(threads);
+		VertexCache cache;
+		BackFaceCulling culling;
+		// One untimed pass sizes the cache's buffers.
+		transformVertices(pool, viewport, frustum, position, orientation, scale, vertices, cache);
+		setupFaces<uint32_t>(pool, viewport, faces, culling, cache);
+
+		sf::Clock clock;
+		for (int i = 0; i < REPETITIONS; ++i) {
+			transformVertices(pool, viewport, frustum, position, orientation, scale, vertices, cache);
+			setupFaces<uint32_t>(pool, viewport, faces, culling, cache);
+		}
+		double ms = clock.getElapsedTime().asMicroseconds() / 1000.0 / REPETITIONS;
+
+		if (threads == 1) {
+			singleThreadMs = ms;
+			reference = cache.triangles;
+		}
+		std::cout << threads << " threads: " << ms << " ms per frame, " << singleThreadMs / ms << "x speedup"
+			<< (cache.triangles == reference ? "" : " (output differs from 1 thread!)") << std::endl;
+		if (threads == maxThreads) {
+			break;
+		}
+	}
+}
+
+// Fills batches of random triangles whose corners are at most `size` pixels apart with each
+// raster path this CPU supports, and reports filled pixels per second. Small triangles measure
+// per-triangle setup cost; large ones measure the per-pixel loop.
+void benchmarkRaster() {
+	Framebuffer framebuffer(sf::Vector2u(1920, 1080));
+	std::vector<RasterPath> paths = { RasterPath::Scalar };
+	if (detectRasterPath() == RasterPath::AVX2) {
+		paths.push_back(RasterPath::AVX2);
+	}
+
+	struct TriangleSize {
+		const char* name;
+		int32_t size;
+		size_t count;
+	};
+	const TriangleSize sizes[] = { { "small", 8, 200000 }, { "medium", 64, 20000 }, { "large", 512, 500 } };
+	std::mt19937 random(449);
+	for (const TriangleSize& triangleSize : sizes) {
+		std::uniform_int_distribution<int32_t> cornerX(0, 1919 - triangleSize.size);
+		std::uniform_int_distribution<int32_t> cornerY(0, 1079 - triangleSize.size);
+		std::uniform_int_distribution<int32_t> offset(0, triangleSize.size);
+		// Three corners per triangle.
+		std::vector<sf::Vector2i> corners;
+		corners.reserve(triangleSize.count * VERTICES_PER_FACE);
+		for (size_t i = 0; i < triangleSize.count; ++i) {
+			sf::Vector2i corner = sf::Vector2i(cornerX(random), cornerY(random));
+			for (size_t j = 0; j < VERTICES_PER_FACE; ++j) {
+				corners.push_back(corner + sf::Vector2i(offset(random), offset(random)));
+			}
+		}
+
+		for (RasterPath path : paths) {
+			framebuffer.clear();
+			sf::Clock clock;
+			size_t pixels = 0;
+			for (size_t i = 0; i < corners.size(); i += VERTICES_PER_FACE) {
+				pixels += fillTriangle(framebuffer, corners[i], corners[i + 1], corners[i + 2], sf::Color::White, path);
+			}
+			double seconds = clock.getElapsedTime().asMicroseconds() / 1e6;
+			std::cout << triangleSize.name << " triangles (" << triangleSize.size << " px), " << rasterPathName(path) << ": "
+				<< pixels / seconds / 1e6 << " million pixels/s, " << pixels / triangleSize.count << " pixels per triangle" << std::endl;
+		}
+	}
+}
+
+// Writes a mesh as a plain OBJ file, for load benchmarks that need one larger than the bunny.
+void writeObj(const std::string& path, const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces) {
+	std::ofstream out(path);
+	for (const Vertex3D& vertex : vertices) {
+		out << "v " << vertex.x << ' ' << vertex.y << ' ' << vertex.z << '\n';
+	}
+	for (size_t i = 0; i < faces.size(); i += VERTICES_PER_FACE) {
+		out << "f " << faces[i] + 1 << ' ' << faces[i + 1] + 1 << ' ' << faces[i + 2] + 1 << '\n';
+	}
+	if (!out) {
+		std::cout << "Could not write " << path << std::endl;
+		exit(1);
+	}
+}
+
+// True if two loads of the same file produced the same triangles, corner by corner. They may
+// number their vertices differently, so the corners' positions are compared, not their indexes.
+bool sameTriangles(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces,
+	const std::vector<Vertex3D>& otherVertices, const std::vector<uint32_t>& otherFaces) {
+	if (faces.size() != otherFaces.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < faces.size(); ++i) {
+		// Assimp and std::from_chars may round the last digit of a coordinate differently.
+		if (!matchesWithinTolerance(vertices[faces[i]], otherVertices[otherFaces[i]])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Times loading the bunny and a 2-million-triangle sphere written as OBJ: with Assimp, with its
+// full post-processing and with only what an OBJ needs (triangulating and joining identical
+// vertices), and with the OBJ parser on 1 thread and on every hardware thread. The mesh cache is
+// not used. Also checks that the OBJ parser produces the same triangles as the minimal import.
+void benchmarkLoad() {
+	std::vector<Vertex3D> sphereVertices;
+	std::vector<uint32_t> sphereFaces;
+	makeSphere(1000, 1000, sphereVertices, sphereFaces);
+	std::string spherePath = (std::filesystem::temp_directory_path() / "benchmark_sphere.obj").string();
+	writeObj(spherePath, sphereVertices, sphereFaces);
+
+	const int REPETITIONS = 3;
+	ThreadPool singleThread(1);
+	ThreadPool allThreads(std::thread::hardware_concurrency());
+	for (const std::string& path : { std::string("models/bunny.obj"), spherePath }) {
+		MappedFile source = MappedFile(path);
+		std::cout << path << " (" << source.bytes().size() / 1024 << " KB)" << std::endl;
+
+		// The fastest of a few runs, in milliseconds; each run loads into fresh vectors.
+		std::vector<Vertex3D> vertices;
+		std::vector<uint32_t> faces;
+		auto time = [&](const char* name, const std::function<void()>& load) {
+			double best = 0;
+			for (int i = 0; i < REPETITIONS; ++i) {
+				vertices.clear();
+				faces.clear();
+				vertices.shrink_to_fit();
+				faces.shrink_to_fit();
+				sf::Clock clock;
+				load();
+				double ms = clock.getElapsedTime().asMicroseconds() / 1000.0;
+				best = i == 0 ? ms : std::min(best, ms);
+			}
+			std::cout << "  " << name << ": " << best << " ms, " << faces.size() / VERTICES_PER_FACE << " triangles, "
+				<< vertices.size() << " vertices" << std::endl;
+			return best;
+		};
+
+		time("Assimp, full post-processing", [&] { assimpLoad(path, vertices, faces, IMPORT_FULL); });
+		double assimpMs = time("Assimp, minimal post-processing", [&] { assimpLoad(path, vertices, faces, IMPORT_MINIMAL); });
+		std::vector<Vertex3D> assimpVertices = vertices;
+		std::vector<uint32_t> assimpFaces = faces;
+		double singleMs = time("OBJ parser, 1 thread", [&] { objLoad(path, source, singleThread, vertices, faces); });
+		double allMs = time("OBJ parser, all threads", [&] { objLoad(path, source, allThreads, vertices, faces); });
+		std::cout << "  OBJ parser: " << assimpMs / singleMs << "x faster than minimal Assimp on 1 thread, "
+			<< assimpMs / allMs << "x on " << allThreads.getThreadCount() << " threads; "
+			<< (sameTriangles(vertices, faces, assimpVertices, assimpFaces) ? "same triangles" : "triangles differ!") << std::endl;
+	}
+	std::filesystem::remove(spherePath);
+}
+
+// Draws the bunny until the window closes, or for as many frames as --headless asks for. Index is
+// the width loadMesh picked for the bunny's face indexes; everything drawn from here on uses it.
+template <typename Index>
+int runDemo(const Options& options, std::optional<sf::RenderWindow>& window, ThreadPool& pool,
+	const LoadedMesh<Index>& bunny) {
+	sf::Vector2u screenSize = window ? window->getSize() : options.headless.resolution;
+	Framebuffer framebuffer{ screenSize };
+	DepthBuffer depthBuffer{ screenSize };
+	VertexCache vertexCache;
+	BackFaceCulling culling{ options.cull, options.frontFace };
+	TileRasterizer rasterizer;
+
+	std::vector<Index> bunnyEdges = extractEdges(bunny.faces());
+	std::cout << bunny.faces().size() / 3 << " faces, " << bunnyEdges.size() / 2 << " unique edges, "
+		<< bunny.INDEX_BYTES * 8 << "-bit indexes" << std::endl;
+
+	// The bunny's levels of detail: just the bunny itself, unless --lod asks for more.
+	std::vector<MeshLevel> bunnyLevels;
+	if (options.lod) {
+		sf::Clock clock;
+		// The simplifier works on 32-bit indexes. Every level has fewer vertices than the bunny, so
+		// its faces fit back in the bunny's index width.
+		std::vector<uint32_t> bunnyFaces(bunny.faces().begin(), bunny.faces().end());
+		bunnyLevels = buildLodChain(bunny.vertices(), bunnyFaces, options.lodErrors);
+		std::cout << "Built " << bunnyLevels.size() << " levels of detail in " << clock.getElapsedTime().asMicroseconds() / 1000.0 << " ms:";
+		for (const MeshLevel& level : bunnyLevels) {
+			std::cout << " " << level.faces.size() / 3 << " faces (error " << level.error << ")";
+		}
+		std::cout << std::endl;
+	}
+	std::vector<std::vector<Index>> bunnyLevelFaces;
+	std::vector<std::vector<Index>> bunnyLevelEdges;
+	LevelsOfDetail<Index> bunnyLods;
+	bunnyLods.maxPixelError = options.lodPixels;
+	bunnyLods.levels.push_back(LodLevel<Index>(bunny.vertices(), bunny.faces(), bunnyEdges, 0.0f));
+	for (const MeshLevel& level : bunnyLevels) {
+		bunnyLevelFaces.push_back(toIndexWidth<Index>(level.faces));
+		bunnyLevelEdges.push_back(extractEdges(std::span<const Index>(bunnyLevelFaces.back())));
+		bunnyLods.levels.push_back(LodLevel<Index>(level.vertices, bunnyLevelFaces.back(), bunnyLevelEdges.back(), level.error));
+	}
+	bunnyLods.draws.assign(bunnyLods.levels.size(), 0);
 
 	sf::Vector3f bunnyPosition = sf::Vector3f(0, -1, -2.5);
 	sf::Vector3f bunnyOrientation = sf::Vector3f(0, 0, 0);
@@ -169,40 +1359,175 @@ int main() {
 	// to compute right and top.
 	float fovy = 60; // This is a fairly narrow field of vision, for a screen that doesn't match
 					 // the exact ratio of human vision.
-	float ratio = static_cast<float>(window.getSize().x) / (window.getSize().y);
+	float ratio = static_cast<float>(screenSize.x) / (screenSize.y);
 	float near = 0.1f;
 	float far = 100.0f;
-	float t = near * tan((fovy * M_PI / 180.0f) / 2);
-	float r = t * ratio;
-	Frustum frustum = Frustum(near, far, r, t);
+	Frustum frustum = makeFrustum(fovy, ratio, near, far);
+	FrustumCulling frustumCulling = FrustumCulling(frustumPlanes(frustum));
+
+	// Draws every object in the scene into one of the render targets, each at the level of detail
+	// its size on screen calls for.
+	auto drawScene{ [&](auto& target) {
+		const LodLevel<Index>& level = bunnyLods.levels[selectLevel(bunnyLods, target.getView(), frustum, bunnyPosition, bunnyOrientation, bunnyScale, bunny.bounds())];
+		if constexpr (std::is_same_v<std::decay_t<decltype(target)>, Framebuffer>) {
+			if (options.fill) {
+				fillMesh(target, options.depthTest ? &depthBuffer : nullptr, rasterizer, pool, vertexCache, culling, frustumCulling, frustum, bunnyPosition, bunnyOrientation, bunnyScale, level.vertices, level.faces, bunny.bounds(), sf::Color::White);
+				return;
+			}
+		}
+		if (options.uniqueEdges) {
+			drawMeshEdges(target, pool, vertexCache, frustumCulling, frustum, bunnyPosition, bunnyOrientation, bunnyScale, level.vertices, level.edges, bunny.bounds(), sf::Color::White);
+		}
+		else {
+			drawMesh(target, pool, vertexCache, culling, frustumCulling, frustum, bunnyPosition, bunnyOrientation, bunnyScale, level.vertices, level.faces, bunny.bounds(), sf::Color::White);
+		}
+	} };
+
+	// The triangles (or, with --edges, lines) drawn and the levels of detail picked, since the
+	// counts were last reset.
+	auto printLodCounts{ [&](size_t frames) {
+		if (options.uniqueEdges) {
+			std::cout << vertexCache.linesDrawn / std::max<size_t>(frames, 1) << " lines drawn per frame";
+		}
+		else {
+			std::cout << vertexCache.trianglesDrawn / std::max<size_t>(frames, 1) << " triangles drawn per frame";
+		}
+		vertexCache.trianglesDrawn = 0;
+		vertexCache.linesDrawn = 0;
+		if (bunnyLods.levels.size() > 1) {
+			std::cout << ", levels of detail drawn:";
+			for (size_t& draws : bunnyLods.draws) {
+				std::cout << " " << draws;
+				draws = 0;
+			}
+		}
+	} };
 
-	auto last = c.getElapsedTime();
-	while (window.isOpen()) {
+	if (options.headless.enabled) {
+		// The same work as each frame of the loop below, without events or a window to present to.
+		int result = runHeadless(options.headless, framebuffer, [&] {
+			advanceTraceFrame();
+			TRACE_SPAN("frame");
+			bunnyPosition.z += 0.001f;
+			framebuffer.clear();
+			if (options.fill && options.depthTest) {
+				depthBuffer.clear();
+			}
+			drawScene(framebuffer);
+		});
+		printLodCounts(options.headless.frames);
+		std::cout << std::endl;
+		return result;
+	}
+
+	LineBatch batch{ *window };
+#ifdef ENABLE_PROFILER
+	size_t framesSinceReport = 0;
+#endif
+	while (window->isOpen()) {
+		advanceTraceFrame();
+		PROFILE_STAGE(ProfileStage::Frame);
+		TRACE_SPAN("frame");
 		// Check for events.
-		while (const std::optional event = window.pollEvent()) {
+		while (const std::optional event = window->pollEvent()) {
 			if (event->is<sf::Event::Closed>()) {
-				window.close();
+				window->close();
 			}
 		}
 		
-#ifdef LOG_FPS
-		// FPS calculation.
-		auto now = c.getElapsedTime();
-		auto diff = now - last;
-		std::cout << 1 / diff.asSeconds() << " FPS " << std::endl;
-		last = now;
+#ifdef ENABLE_PROFILER
+		++framesSinceReport;
+		if (stageProfiler().reportDue()) {
+			stageProfiler().report(std::cout);
+			printLodCounts(framesSinceReport);
+			framesSinceReport = 0;
+			std::cout << ", " << vertexCache.verticesTransformed << " vertices transformed";
+			vertexCache.verticesTransformed = 0;
+			std::cout << ", " << vertexCache.facesClipped << " faces clipped";
+			vertexCache.facesClipped = 0;
+			std::cout << ", " << frustumCulling.culled << " of " << frustumCulling.submitted << " objects outside the frustum";
+			frustumCulling.submitted = 0;
+			frustumCulling.culled = 0;
+			if (options.fill) {
+				// Overdraw is how many times each pixel was written, on average.
+				const RasterStats& stats = rasterizer.getStats();
+				std::cout << ", overdraw " << static_cast<double>(stats.pixelsWritten) / (framebuffer.getSize().x * framebuffer.getSize().y)
+					<< ", " << stats.pixelsTested << " pixels tested, " << stats.blocksRejected << " blocks and "
+					<< stats.trianglesRejected << " triangles rejected early";
+				rasterizer.resetStats();
+			}
+			if (culling.enabled) {
+				std::cout << ", " << culling.culled << " of " << culling.submitted << " triangles culled";
+				culling.submitted = 0;
+				culling.culled = 0;
+			}
+			std::cout << std::endl;
+		}
 #endif
 
 		// Rotate the bunny by incrementing the orientation. This is a "yaw" around the y axis.
 		bunnyPosition.z += 0.001f;
 
 		// Render the scene.
-		window.clear();
-		drawMesh(window, frustum, bunnyPosition, bunnyOrientation, bunnyScale, bunnyVertices, bunnyFaces, sf::Color::White);
-		window.display();
+		switch (options.submission) {
+		case SubmissionMode::Immediate:
+			window->clear();
+			drawScene(*window);
+			break;
+		case SubmissionMode::Batched:
+			window->clear();
+			drawScene(batch);
+			break;
+		case SubmissionMode::Framebuffer:
+			framebuffer.clear();
+			if (options.fill && options.depthTest) {
+				depthBuffer.clear();
+			}
+			drawScene(framebuffer);
+			break;
+		}
+		PROFILE_STAGE(ProfileStage::Present);
+		TRACE_SPAN("present");
+		if (options.submission == SubmissionMode::Framebuffer) {
+			TRACE_SPAN("framebuffer.present");
+			framebuffer.present(*window);
+		}
+		TRACE_SPAN("window.display");
+		window->display();
 	}
-
 	return 0;
 }
 
+int main(int argc, char* argv[]) {
+	Options options{ parseOptions(argc, argv) };
+	startTrace(options.trace);
+	if (options.benchmarkThreads) {
+		benchmarkThreads();
+		finishTrace();
+		return 0;
+	}
+	if (options.benchmarkRaster) {
+		benchmarkRaster();
+		finishTrace();
+		return 0;
+	}
+	if (options.benchmarkLoad) {
+		benchmarkLoad();
+		finishTrace();
+		return 0;
+	}
+
+	// Headless runs never open a window, so they work on machines without a display.
+	std::optional<sf::RenderWindow> window;
+	if (!options.headless.enabled) {
+		TRACE_SPAN("open window");
+		window.emplace(sf::VideoMode::getFullscreenModes().at(0), "SFML Demo");
+	}
+	ThreadPool pool(options.threads > 0 ? options.threads : std::thread::hardware_concurrency());
+	AnyLoadedMesh bunny = loadMesh("models/bunny.obj", options.loader, options.importFlags, options.optimize, pool);
+	int result = std::visit([&](const auto& mesh) { return runDemo(options, window, pool, mesh); }, bunny);
+	finishTrace();
+	return result;
+}
+
 // Why don't we see the cube in 3D? 
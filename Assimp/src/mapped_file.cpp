@@ -0,0 +1,90 @@
+#include "mapped_file.h"
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#if defined(_WIN32)
+	HANDLE file{ CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	LARGE_INTEGER size{};
+	if (GetFileSizeEx(file, &size) && size.QuadPart == 0) {
+		m_open = true;
+	}
+	else if (size.QuadPart > 0) {
+		// The view keeps the file open; the handles can be closed straight away.
+		HANDLE mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+		if (mapping != nullptr) {
+			m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+		if (m_data != nullptr) {
+			m_size = static_cast<size_t>(size.QuadPart);
+			m_open = true;
+		}
+	}
+	CloseHandle(file);
+#else
+	int file{ ::open(path.c_str(), O_RDONLY) };
+	if (file < 0) {
+		return;
+	}
+	struct stat status{};
+	if (fstat(file, &status) == 0 && status.st_size == 0) {
+		// mmap refuses empty mappings, but an empty file is still a file.
+		m_open = true;
+	}
+	else if (status.st_size > 0) {
+		void* data{ mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0) };
+		if (data != MAP_FAILED) {
+			m_data = data;
+			m_size = static_cast<size_t>(status.st_size);
+			m_open = true;
+		}
+	}
+	::close(file);
+#endif
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_open{ std::exchange(other.m_open, false) }, m_data{ std::exchange(other.m_data, nullptr) },
+	m_size{ std::exchange(other.m_size, 0) } {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		m_open = std::exchange(other.m_open, false);
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+	}
+	return *this;
+}
+
+void MappedFile::close() {
+	if (m_data != nullptr) {
+#if defined(_WIN32)
+		UnmapViewOfFile(m_data);
+#else
+		munmap(const_cast<void*>(m_data), m_size);
+#endif
+	}
+	m_open = false;
+	m_data = nullptr;
+	m_size = 0;
+}
@@ -0,0 +1,161 @@
+#include "mesh_cache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace {
+	// Bumped whenever the layout below changes, so older caches are rebuilt instead of misread.
+	const uint32_t CACHE_VERSION{ 4 };
+	const char CACHE_MAGIC[8]{ 'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H' };
+	// The vertex array starts at a multiple of this, so it is as aligned as if it were allocated.
+	const size_t ARRAY_ALIGNMENT{ 16 };
+
+	struct MeshCacheHeader {
+		char magic[8];
+		uint32_t version;
+		// sizeof(Vertex3D) when the cache was written, in case its layout ever changes.
+		uint32_t vertexSize;
+		// sizeof the face indexes: 2 or 4 bytes, whichever the vertex count calls for.
+		uint32_t indexSize;
+		MeshCacheKey key;
+		uint64_t vertexCount;
+		uint64_t indexCount;
+		MeshBounds bounds;
+	};
+
+	size_t alignUp(size_t offset, size_t alignment) {
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	size_t vertexOffset() {
+		return alignUp(sizeof(MeshCacheHeader), ARRAY_ALIGNMENT);
+	}
+
+	size_t indexOffset(uint64_t vertexCount) {
+		return vertexOffset() + vertexCount * sizeof(Vertex3D);
+	}
+
+	// The index width a mesh with this many vertices is stored with.
+	uint32_t indexSizeFor(uint64_t vertexCount) {
+		return vertexCount <= MAX_16_BIT_VERTICES ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+	// Views the faces of a cache whose header has already been checked, as long as every index
+	// is in range. The key only covers the source file, so a cache damaged after it was written
+	// can still match; checking every index once is cheap next to parsing the source, and keeps a
+	// bad one from reading past the end of the vertex arrays when the mesh is drawn.
+	template <typename Index>
+	std::optional<AnyLoadedMesh> viewMesh(MappedFile file, const MeshCacheHeader& header) {
+		std::span<const std::byte> bytes{ file.bytes() };
+		const Vertex3D* vertices{ reinterpret_cast<const Vertex3D*>(bytes.data() + vertexOffset()) };
+		const Index* faces{ reinterpret_cast<const Index*>(bytes.data() + indexOffset(header.vertexCount)) };
+		for (uint64_t i{ 0 }; i < header.indexCount; ++i) {
+			if (faces[i] >= header.vertexCount) {
+				return std::nullopt;
+			}
+		}
+		return AnyLoadedMesh{ LoadedMesh<Index>{ std::move(file), { vertices, header.vertexCount },
+			{ faces, header.indexCount }, header.bounds } };
+	}
+
+	template <typename Index>
+	bool writeCache(const std::string& cachePath, const MeshCacheKey& key, const LoadedMesh<Index>& mesh) {
+		MeshCacheHeader header{};
+		std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		header.version = CACHE_VERSION;
+		header.vertexSize = sizeof(Vertex3D);
+		header.indexSize = sizeof(Index);
+		header.key = key;
+		header.vertexCount = mesh.vertices().size();
+		header.indexCount = mesh.faces().size();
+		header.bounds = mesh.bounds();
+
+		std::string temporaryPath{ cachePath + ".tmp" };
+		{
+			std::ofstream out{ temporaryPath, std::ios::binary | std::ios::trunc };
+			if (!out) {
+				return false;
+			}
+			const char padding[ARRAY_ALIGNMENT]{};
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(padding, vertexOffset() - sizeof(header));
+			out.write(reinterpret_cast<const char*>(mesh.vertices().data()), mesh.vertices().size_bytes());
+			out.write(reinterpret_cast<const char*>(mesh.faces().data()), mesh.faces().size_bytes());
+			if (!out.flush()) {
+				out.close();
+				std::error_code ignored;
+				std::filesystem::remove(temporaryPath, ignored);
+				return false;
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, cachePath, error);
+		if (error) {
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+		return true;
+	}
+}
+
+uint64_t hashBytes(std::span<const std::byte> bytes) {
+	// Eight bytes per step: multiplying spreads each word's low bits upward, and the shift brings
+	// the high bits back down, so a change anywhere in the file changes the whole hash. This is not
+	// meant to resist deliberate collisions, only to notice a model that was edited or replaced.
+	const uint64_t MULTIPLIER{ 0x9E3779B97F4A7C15 };
+	uint64_t hash{ 0xCBF29CE484222325 ^ bytes.size() };
+	size_t i{ 0 };
+	for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+		uint64_t word;
+		std::memcpy(&word, bytes.data() + i, sizeof(word));
+		hash = (hash ^ word) * MULTIPLIER;
+		hash ^= hash >> 32;
+	}
+	for (; i < bytes.size(); ++i) {
+		hash = (hash ^ std::to_integer<uint64_t>(bytes[i])) * MULTIPLIER;
+		hash ^= hash >> 32;
+	}
+	return hash;
+}
+
+std::string meshCachePath(const std::string& sourcePath) {
+	return sourcePath + ".meshcache";
+}
+
+std::optional<AnyLoadedMesh> readMeshCache(const std::string& cachePath, const MeshCacheKey& key) {
+	MappedFile file{ cachePath };
+	std::span<const std::byte> bytes{ file.bytes() };
+	if (bytes.size() < vertexOffset()) {
+		return std::nullopt;
+	}
+	MeshCacheHeader header;
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION
+		|| header.vertexSize != sizeof(Vertex3D) || header.indexSize != indexSizeFor(header.vertexCount)
+		|| header.key.sourceHash != key.sourceHash
+		|| header.key.sourceSize != key.sourceSize || header.key.loader != key.loader
+		|| header.key.importFlags != key.importFlags || header.key.passes != key.passes) {
+		return std::nullopt;
+	}
+	// A truncated file, or counts too large to be real, would otherwise send us reading past the
+	// end of the mapping.
+	uint64_t maxVertices{ bytes.size() / sizeof(Vertex3D) };
+	uint64_t maxIndexes{ bytes.size() / header.indexSize };
+	if (header.vertexCount > maxVertices || header.indexCount > maxIndexes || header.indexCount % 3 != 0
+		|| indexOffset(header.vertexCount) + header.indexCount * header.indexSize != bytes.size()) {
+		return std::nullopt;
+	}
+	if (header.indexSize == sizeof(uint16_t)) {
+		return viewMesh<uint16_t>(std::move(file), header);
+	}
+	return viewMesh<uint32_t>(std::move(file), header);
+}
+
+bool writeMeshCache(const std::string& cachePath, const MeshCacheKey& key, const LoadedMesh<uint16_t>& mesh) {
+	return writeCache(cachePath, key, mesh);
+}
+
+bool writeMeshCache(const std::string& cachePath, const MeshCacheKey& key, const LoadedMesh<uint32_t>& mesh) {
+	return writeCache(cachePath, key, mesh);
+}
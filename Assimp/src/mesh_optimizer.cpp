@@ -0,0 +1,197 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include "trace.h"
+
+namespace {
+	// The parameters from Forsyth's paper, tuned for a least-recently-used cache of 32 vertices.
+	const int CACHE_SIZE{ 32 };
+	const float CACHE_DECAY_POWER{ 1.5f };
+	const float LAST_TRIANGLE_SCORE{ 0.75f };
+	const float VALENCE_BOOST_SCALE{ 2.0f };
+	const float VALENCE_BOOST_POWER{ 0.5f };
+	// Vertices with more triangles left than this all get the same (smallest) valence boost.
+	const int MAX_VALENCE{ 32 };
+
+	const size_t VERTICES_PER_TRIANGLE{ 3 };
+
+	// Score tables, so the scores are looked up rather than computed with pow for every update.
+	struct ScoreTables {
+		float cache[CACHE_SIZE];
+		float valence[MAX_VALENCE + 1];
+
+		ScoreTables() {
+			for (int position{ 0 }; position < CACHE_SIZE; ++position) {
+				// The three vertices of the triangle just drawn get a fixed score, lower than the
+				// next few, so the next triangle is not simply its neighbor across the newest edge.
+				cache[position] = position < 3
+					? LAST_TRIANGLE_SCORE
+					: std::pow(1.0f - static_cast<float>(position - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+			valence[0] = 0;
+			for (int remaining{ 1 }; remaining <= MAX_VALENCE; ++remaining) {
+				// Vertices with few triangles left are worth finishing, so they leave the cache.
+				valence[remaining] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+			}
+		}
+	};
+
+	float vertexScore(const ScoreTables& tables, int cachePosition, uint32_t remaining) {
+		if (remaining == 0) {
+			return -1.0f;
+		}
+		float score{ cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f };
+		return score + tables.valence[std::min<uint32_t>(remaining, MAX_VALENCE)];
+	}
+}
+
+void optimizeVertexCache(std::span<uint32_t> faces, size_t vertexCount) {
+	TRACE_SPAN("optimizeVertexCache");
+	static const ScoreTables tables;
+	size_t triangleCount{ faces.size() / VERTICES_PER_TRIANGLE };
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// Each vertex's triangles, as ranges of one shared array. The first remaining[v] entries of a
+	// vertex's range are the triangles not yet emitted.
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : faces) {
+		++remaining[index];
+	}
+	std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+	for (size_t v{ 0 }; v < vertexCount; ++v) {
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+	}
+	std::vector<uint32_t> vertexTriangles(faces.size());
+	{
+		std::vector<uint32_t> filled(vertexCount, 0);
+		for (size_t i{ 0 }; i < faces.size(); ++i) {
+			uint32_t vertex{ faces[i] };
+			vertexTriangles[firstTriangle[vertex] + filled[vertex]++] = static_cast<uint32_t>(i / VERTICES_PER_TRIANGLE);
+		}
+	}
+
+	std::vector<float> scores(vertexCount);
+	for (size_t v{ 0 }; v < vertexCount; ++v) {
+		scores[v] = vertexScore(tables, -1, remaining[v]);
+	}
+	auto triangleScore{ [&](size_t triangle) {
+		const uint32_t* corners{ &faces[triangle * VERTICES_PER_TRIANGLE] };
+		return scores[corners[0]] + scores[corners[1]] + scores[corners[2]];
+	} };
+	std::vector<bool> emitted(triangleCount, false);
+
+	// The cache holds CACHE_SIZE vertices, plus room for the three a new triangle pushes in
+	// before the oldest are evicted.
+	uint32_t cache[CACHE_SIZE + 3];
+	uint32_t newCache[CACHE_SIZE + 3];
+	int cacheCount{ 0 };
+
+	std::vector<uint32_t> output;
+	output.reserve(faces.size());
+	// When no triangle in the cache is left, we restart from the next triangle in file order that
+	// has not been emitted, which keeps the whole pass linear in the number of triangles.
+	size_t scanFrom{ 0 };
+	int64_t best{ 0 };
+	for (size_t t{ 1 }; t < triangleCount; ++t) {
+		if (triangleScore(t) > triangleScore(best)) {
+			best = static_cast<int64_t>(t);
+		}
+	}
+
+	while (best >= 0) {
+		const uint32_t* corners{ &faces[best * VERTICES_PER_TRIANGLE] };
+		emitted[best] = true;
+		output.insert(output.end(), corners, corners + VERTICES_PER_TRIANGLE);
+
+		// Remove the triangle from its vertices' remaining lists.
+		for (size_t c{ 0 }; c < VERTICES_PER_TRIANGLE; ++c) {
+			uint32_t vertex{ corners[c] };
+			uint32_t* triangles{ &vertexTriangles[firstTriangle[vertex]] };
+			uint32_t last{ --remaining[vertex] };
+			for (uint32_t i{ 0 }; i <= last; ++i) {
+				if (triangles[i] == static_cast<uint32_t>(best)) {
+					std::swap(triangles[i], triangles[last]);
+					break;
+				}
+			}
+		}
+
+		// Move the triangle's vertices to the front of the cache, keeping the rest in order.
+		int newCount{ 0 };
+		for (size_t c{ 0 }; c < VERTICES_PER_TRIANGLE; ++c) {
+			newCache[newCount++] = corners[c];
+		}
+		for (int i{ 0 }; i < cacheCount; ++i) {
+			uint32_t vertex{ cache[i] };
+			if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+				newCache[newCount++] = vertex;
+			}
+		}
+		for (int i{ CACHE_SIZE }; i < newCount; ++i) {
+			scores[newCache[i]] = vertexScore(tables, -1, remaining[newCache[i]]);
+		}
+		cacheCount = std::min(newCount, CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		// Only vertices in the cache changed score (besides the evicted ones, whose triangles can
+		// only have gotten worse), so the next triangle is looked for among theirs.
+		for (int i{ 0 }; i < cacheCount; ++i) {
+			scores[cache[i]] = vertexScore(tables, i, remaining[cache[i]]);
+		}
+		best = -1;
+		float bestScore{ -1.0f };
+		for (int i{ 0 }; i < cacheCount; ++i) {
+			uint32_t vertex{ cache[i] };
+			const uint32_t* triangles{ &vertexTriangles[firstTriangle[vertex]] };
+			for (uint32_t j{ 0 }; j < remaining[vertex]; ++j) {
+				float score{ triangleScore(triangles[j]) };
+				if (score > bestScore) {
+					bestScore = score;
+					best = triangles[j];
+				}
+			}
+		}
+		if (best < 0) {
+			while (scanFrom < triangleCount && emitted[scanFrom]) {
+				++scanFrom;
+			}
+			best = scanFrom < triangleCount ? static_cast<int64_t>(scanFrom) : -1;
+		}
+	}
+	std::copy(output.begin(), output.end(), faces.begin());
+}
+
+void optimizeVertexFetch(std::vector<Vertex3D>& vertices, std::span<uint32_t> faces) {
+	TRACE_SPAN("optimizeVertexFetch");
+	const uint32_t UNUSED{ UINT32_MAX };
+	std::vector<uint32_t> remap(vertices.size(), UNUSED);
+	std::vector<Vertex3D> reordered;
+	reordered.reserve(vertices.size());
+	for (uint32_t& index : faces) {
+		if (remap[index] == UNUSED) {
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices = std::move(reordered);
+}
+
+double averageCacheMissRatio(std::span<const uint32_t> faces, size_t vertexCount, size_t cacheSize) {
+	size_t triangleCount{ faces.size() / VERTICES_PER_TRIANGLE };
+	if (triangleCount == 0) {
+		return 0;
+	}
+	// A vertex is in the cache while fewer than cacheSize misses have happened since its own; the
+	// misses are numbered from 1, so 0 means never loaded.
+	std::vector<size_t> loadedAt(vertexCount, 0);
+	size_t misses{ 0 };
+	for (uint32_t index : faces) {
+		if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize) {
+			loadedAt[index] = ++misses;
+		}
+	}
+	return static_cast<double>(misses) / triangleCount;
+}
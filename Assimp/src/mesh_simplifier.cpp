@@ -0,0 +1,307 @@
+#include "mesh_simplifier.h"
+#include <algorithm>
+#include <cmath>
+#include "edges.h"
+#include "mesh_optimizer.h"
+#include "trace.h"
+
+namespace {
+	const size_t VERTICES_PER_TRIANGLE{ 3 };
+	// How much more a border edge's plane counts than a triangle's, so holes keep their outline.
+	const double BORDER_WEIGHT{ 10.0 };
+	// A level must have at most this fraction of the previous level's triangles to be kept.
+	const double MIN_LEVEL_REDUCTION{ 0.9 };
+
+	struct Vector {
+		double x;
+		double y;
+		double z;
+	};
+
+	Vector operator-(const Vector& a, const Vector& b) {
+		return Vector{ a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+
+	Vector cross(const Vector& a, const Vector& b) {
+		return Vector{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	double dot(const Vector& a, const Vector& b) {
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	// The symmetric 4x4 matrix of a sum of squared plane distances, keeping only its upper
+	// triangle, and the total weight of the planes in it.
+	struct Quadric {
+		double xx, xy, xz, xw, yy, yz, yw, zz, zw, ww;
+		double weight;
+
+		// Adds the plane normal . p + distance = 0, for a unit normal.
+		void addPlane(const Vector& normal, double distance, double planeWeight) {
+			xx += planeWeight * normal.x * normal.x;
+			xy += planeWeight * normal.x * normal.y;
+			xz += planeWeight * normal.x * normal.z;
+			xw += planeWeight * normal.x * distance;
+			yy += planeWeight * normal.y * normal.y;
+			yz += planeWeight * normal.y * normal.z;
+			yw += planeWeight * normal.y * distance;
+			zz += planeWeight * normal.z * normal.z;
+			zw += planeWeight * normal.z * distance;
+			ww += planeWeight * distance * distance;
+			weight += planeWeight;
+		}
+
+		Quadric& operator+=(const Quadric& other) {
+			xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+			yy += other.yy; yz += other.yz; yw += other.yw;
+			zz += other.zz; zw += other.zw;
+			ww += other.ww;
+			weight += other.weight;
+			return *this;
+		}
+
+		// The weighted sum of squared distances from p to the planes.
+		double evaluate(const Vector& p) const {
+			return xx * p.x * p.x + 2 * xy * p.x * p.y + 2 * xz * p.x * p.z + 2 * xw * p.x
+				+ yy * p.y * p.y + 2 * yz * p.y * p.z + 2 * yw * p.y
+				+ zz * p.z * p.z + 2 * zw * p.z
+				+ ww;
+		}
+	};
+
+	// A candidate collapse, moving vertex `from` onto vertex `to`.
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		float error;
+	};
+
+	// The error of collapsing `from` onto `to`: the root mean square distance from `to` to every
+	// plane the two vertices stand for.
+	float collapseError(const std::vector<Quadric>& quadrics, const std::vector<Vector>& positions,
+		uint32_t from, uint32_t to) {
+		Quadric sum{ quadrics[from] };
+		sum += quadrics[to];
+		if (sum.weight <= 0) {
+			return 0;
+		}
+		return static_cast<float>(std::sqrt(std::max(0.0, sum.evaluate(positions[to])) / sum.weight));
+	}
+
+	// True if moving `from` onto `to` would turn any triangle around `from` (other than those
+	// also around `to`, which disappear) to face the other way, or squash it flat.
+	bool flipsTriangle(std::span<const uint32_t> faces, std::span<const uint32_t> triangles,
+		const std::vector<Vector>& positions, uint32_t from, uint32_t to) {
+		for (uint32_t triangle : triangles) {
+			const uint32_t* corners{ &faces[triangle * VERTICES_PER_TRIANGLE] };
+			if (corners[0] == to || corners[1] == to || corners[2] == to) {
+				continue;
+			}
+			// Rotate the triangle so `from` comes first, keeping its winding.
+			size_t first{ corners[0] == from ? 0u : corners[1] == from ? 1u : 2u };
+			const Vector& b{ positions[corners[(first + 1) % 3]] };
+			const Vector& c{ positions[corners[(first + 2) % 3]] };
+			Vector before{ cross(b - positions[from], c - positions[from]) };
+			Vector after{ cross(b - positions[to], c - positions[to]) };
+			// Also rejects triangles whose normal turns by more than about 80 degrees.
+			if (dot(before, after) <= 0.2 * std::sqrt(dot(before, before) * dot(after, after))) {
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+std::vector<uint32_t> simplifyMesh(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces,
+	size_t targetIndexCount, float maxError, float& resultError) {
+	TRACE_SPAN("simplifyMesh");
+	resultError = 0;
+	std::vector<uint32_t> result(faces.begin(), faces.end());
+	size_t vertexCount{ vertices.size() };
+	if (vertexCount == 0 || result.size() <= targetIndexCount) {
+		return result;
+	}
+
+	// Work on positions centered on the bounding box and scaled to a radius of about 1, so errors
+	// come out as fractions of the mesh's size.
+	Vertex3D low{ vertices[0] };
+	Vertex3D high{ vertices[0] };
+	for (const Vertex3D& vertex : vertices) {
+		low = Vertex3D{ std::min(low.x, vertex.x), std::min(low.y, vertex.y), std::min(low.z, vertex.z) };
+		high = Vertex3D{ std::max(high.x, vertex.x), std::max(high.y, vertex.y), std::max(high.z, vertex.z) };
+	}
+	Vector center{ (low.x + high.x) / 2.0, (low.y + high.y) / 2.0, (low.z + high.z) / 2.0 };
+	Vector extent{ Vector{ high.x, high.y, high.z } - center };
+	double radius{ std::sqrt(dot(extent, extent)) };
+	double scale{ radius > 0 ? 1 / radius : 1 };
+	std::vector<Vector> positions(vertexCount);
+	for (size_t v{ 0 }; v < vertexCount; ++v) {
+		positions[v] = Vector{ (vertices[v].x - center.x) * scale, (vertices[v].y - center.y) * scale, (vertices[v].z - center.z) * scale };
+	}
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i{ 0 }; i + 2 < result.size(); i += VERTICES_PER_TRIANGLE) {
+		const Vector& a{ positions[result[i]] };
+		Vector normal{ cross(positions[result[i + 1]] - a, positions[result[i + 2]] - a) };
+		double length{ std::sqrt(dot(normal, normal)) };
+		if (length == 0) {
+			continue;
+		}
+		normal = Vector{ normal.x / length, normal.y / length, normal.z / length };
+		double area{ length / 2 };
+		for (size_t c{ 0 }; c < VERTICES_PER_TRIANGLE; ++c) {
+			quadrics[result[i + c]].addPlane(normal, -dot(normal, a), area);
+		}
+	}
+
+	// Border edges belong to one triangle only: their directed edge has no opposite.
+	{
+		std::vector<uint64_t> directed;
+		directed.reserve(result.size());
+		for (size_t i{ 0 }; i + 2 < result.size(); i += VERTICES_PER_TRIANGLE) {
+			for (size_t c{ 0 }; c < VERTICES_PER_TRIANGLE; ++c) {
+				uint64_t from{ result[i + c] };
+				uint64_t to{ result[i + (c + 1) % VERTICES_PER_TRIANGLE] };
+				directed.push_back((from << 32) | to);
+			}
+		}
+		std::vector<uint64_t> sorted{ directed };
+		std::sort(sorted.begin(), sorted.end());
+		for (size_t i{ 0 }; i < directed.size(); ++i) {
+			uint32_t from{ static_cast<uint32_t>(directed[i] >> 32) };
+			uint32_t to{ static_cast<uint32_t>(directed[i]) };
+			uint64_t opposite{ (static_cast<uint64_t>(to) << 32) | from };
+			if (std::binary_search(sorted.begin(), sorted.end(), opposite)) {
+				continue;
+			}
+			size_t triangle{ i / VERTICES_PER_TRIANGLE * VERTICES_PER_TRIANGLE };
+			const Vector& a{ positions[result[triangle]] };
+			Vector faceNormal{ cross(positions[result[triangle + 1]] - a, positions[result[triangle + 2]] - a) };
+			Vector edge{ positions[to] - positions[from] };
+			Vector normal{ cross(edge, faceNormal) };
+			double length{ std::sqrt(dot(normal, normal)) };
+			if (length == 0) {
+				continue;
+			}
+			normal = Vector{ normal.x / length, normal.y / length, normal.z / length };
+			double weight{ dot(edge, edge) * BORDER_WEIGHT };
+			quadrics[from].addPlane(normal, -dot(normal, positions[from]), weight);
+			quadrics[to].addPlane(normal, -dot(normal, positions[from]), weight);
+		}
+	}
+
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> locked(vertexCount);
+	std::vector<uint32_t> remaining(vertexCount);
+	std::vector<uint32_t> firstTriangle(vertexCount + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+	while (result.size() > targetIndexCount) {
+		// Each vertex's triangles in the current faces, as ranges of one shared array.
+		std::fill(remaining.begin(), remaining.end(), 0);
+		for (uint32_t index : result) {
+			++remaining[index];
+		}
+		firstTriangle[0] = 0;
+		for (size_t v{ 0 }; v < vertexCount; ++v) {
+			firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+		}
+		vertexTriangles.resize(result.size());
+		std::fill(remaining.begin(), remaining.end(), 0);
+		for (size_t i{ 0 }; i < result.size(); ++i) {
+			uint32_t vertex{ result[i] };
+			vertexTriangles[firstTriangle[vertex] + remaining[vertex]++] = static_cast<uint32_t>(i / VERTICES_PER_TRIANGLE);
+		}
+		auto trianglesOf{ [&](uint32_t vertex) {
+			return std::span<const uint32_t>{ vertexTriangles.data() + firstTriangle[vertex], remaining[vertex] };
+		} };
+
+		// Every edge, in whichever direction is cheaper to collapse, cheapest first.
+		collapses.clear();
+		std::vector<uint32_t> edges{ extractEdges(result) };
+		for (size_t i{ 0 }; i < edges.size(); i += 2) {
+			uint32_t a{ edges[i] };
+			uint32_t b{ edges[i + 1] };
+			float toB{ collapseError(quadrics, positions, a, b) };
+			float toA{ collapseError(quadrics, positions, b, a) };
+			collapses.push_back(toB <= toA ? Collapse{ a, b, toB } : Collapse{ b, a, toA });
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+			return x.error < y.error;
+		});
+
+		// Each collapse removes about two triangles; stop once enough are gone.
+		size_t triangleExcess{ (result.size() - targetIndexCount) / VERTICES_PER_TRIANGLE };
+		size_t collapseBudget{ triangleExcess / 2 + 1 };
+		size_t collapsed{ 0 };
+		for (size_t v{ 0 }; v < vertexCount; ++v) {
+			remap[v] = static_cast<uint32_t>(v);
+		}
+		std::fill(locked.begin(), locked.end(), false);
+		for (const Collapse& collapse : collapses) {
+			if (collapse.error > maxError || collapsed >= collapseBudget) {
+				break;
+			}
+			if (locked[collapse.from] || locked[collapse.to]) {
+				continue;
+			}
+			if (flipsTriangle(result, trianglesOf(collapse.from), positions, collapse.from, collapse.to)) {
+				continue;
+			}
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			resultError = std::max(resultError, collapse.error);
+			++collapsed;
+			// Nothing else this pass may touch the triangles that just changed, since the
+			// adjacency and flip tests above describe the faces as they were.
+			for (uint32_t vertex : { collapse.from, collapse.to }) {
+				for (uint32_t triangle : trianglesOf(vertex)) {
+					for (size_t c{ 0 }; c < VERTICES_PER_TRIANGLE; ++c) {
+						locked[result[triangle * VERTICES_PER_TRIANGLE + c]] = true;
+					}
+				}
+			}
+		}
+		if (collapsed == 0) {
+			break;
+		}
+
+		// Apply the collapses, dropping triangles that lost a corner.
+		size_t kept{ 0 };
+		for (size_t i{ 0 }; i + 2 < result.size(); i += VERTICES_PER_TRIANGLE) {
+			uint32_t a{ remap[result[i]] };
+			uint32_t b{ remap[result[i + 1]] };
+			uint32_t c{ remap[result[i + 2]] };
+			if (a != b && b != c && c != a) {
+				result[kept++] = a;
+				result[kept++] = b;
+				result[kept++] = c;
+			}
+		}
+		result.resize(kept);
+	}
+	return result;
+}
+
+std::vector<MeshLevel> buildLodChain(std::span<const Vertex3D> vertices, std::span<const uint32_t> faces,
+	std::span<const float> maxErrors) {
+	TRACE_SPAN("buildLodChain");
+	std::vector<MeshLevel> levels;
+	// Each level is simplified from the original mesh rather than the previous level, so errors
+	// do not compound, but aims for half the previous level's size.
+	size_t previousCount{ faces.size() };
+	for (float maxError : maxErrors) {
+		size_t target{ previousCount / VERTICES_PER_TRIANGLE / 2 * VERTICES_PER_TRIANGLE };
+		MeshLevel level;
+		level.faces = simplifyMesh(vertices, faces, target, maxError, level.error);
+		if (level.faces.size() > previousCount * MIN_LEVEL_REDUCTION) {
+			break;
+		}
+		optimizeVertexCache(level.faces, vertices.size());
+		level.vertices.assign(vertices.begin(), vertices.end());
+		optimizeVertexFetch(level.vertices, level.faces);
+		previousCount = level.faces.size();
+		levels.push_back(std::move(level));
+	}
+	return levels;
+}
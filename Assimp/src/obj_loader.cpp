@@ -0,0 +1,214 @@
+#include "obj_loader.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+namespace {
+	// Chunks smaller than this are not worth handing to another thread.
+	const size_t MIN_CHUNK_BYTES{ 1 << 20 };
+
+	// One line-aligned slice of the file, and what parsing it produced.
+	struct ObjChunk {
+		const char* begin{ nullptr };
+		const char* end{ nullptr };
+		// Where this chunk's vertices start in the output, and how many it has.
+		size_t vertexOffset{ 0 };
+		size_t vertexCount{ 0 };
+		std::vector<uint32_t> faces;
+		// The first problem found, and where, so the caller can report its line number.
+		std::string error;
+		const char* errorAt{ nullptr };
+	};
+
+	bool isSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* skipSpaces(const char* p, const char* end) {
+		while (p < end && isSpace(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	// Calls lineBody(begin, end) for each line in [begin, end), without its newline.
+	template <typename LineBody>
+	void forEachLine(const char* begin, const char* end, LineBody lineBody) {
+		while (begin < end) {
+			const char* newline{ static_cast<const char*>(std::memchr(begin, '\n', end - begin)) };
+			const char* lineEnd{ newline != nullptr ? newline : end };
+			if (!lineBody(begin, lineEnd)) {
+				return;
+			}
+			begin = lineEnd + 1;
+		}
+	}
+
+	// True if the line holds a record of the given type, like "v" or "f", leaving p after it.
+	bool isRecord(const char*& p, const char* end, char type) {
+		const char* start{ skipSpaces(p, end) };
+		if (end - start < 2 || start[0] != type || !isSpace(start[1])) {
+			return false;
+		}
+		p = start + 2;
+		return true;
+	}
+
+	bool parseFloat(const char*& p, const char* end, float& value) {
+		p = skipSpaces(p, end);
+		// from_chars follows the C locale's rules, which do not allow a leading plus sign.
+		if (p < end && *p == '+') {
+			++p;
+		}
+		auto [next, error] { std::from_chars(p, end, value) };
+		if (error != std::errc{}) {
+			return false;
+		}
+		p = next;
+		return true;
+	}
+
+	bool parseVertex(const char* p, const char* end, Vertex3D& vertex) {
+		// A fourth coordinate, w, is allowed but only matters for curves.
+		return parseFloat(p, end, vertex.x) && parseFloat(p, end, vertex.y) && parseFloat(p, end, vertex.z);
+	}
+
+	// Parses the corners of a face and appends it as triangles. `vertexCount` is the number of
+	// vertices defined before this line, which negative indexes count back from, and
+	// `totalVertices` the number in the whole file, which positive indexes must stay below.
+	bool parseFace(const char* p, const char* end, size_t vertexCount, size_t totalVertices,
+		std::vector<uint32_t>& corners, std::vector<uint32_t>& faces) {
+		corners.clear();
+		while (true) {
+			p = skipSpaces(p, end);
+			if (p == end) {
+				break;
+			}
+			int64_t index{ 0 };
+			auto [next, error] { std::from_chars(p, end, index) };
+			if (error != std::errc{}) {
+				return false;
+			}
+			// OBJ indexes start at 1; negative ones count back from the latest vertex.
+			int64_t resolved{ index > 0 ? index - 1 : static_cast<int64_t>(vertexCount) + index };
+			if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(totalVertices)) {
+				return false;
+			}
+			corners.push_back(static_cast<uint32_t>(resolved));
+			// Skip the texture coordinate and normal indexes.
+			p = next;
+			while (p < end && !isSpace(*p)) {
+				++p;
+			}
+		}
+		if (corners.size() < 3) {
+			return false;
+		}
+		for (size_t i{ 1 }; i + 1 < corners.size(); ++i) {
+			faces.insert(faces.end(), { corners[0], corners[i], corners[i + 1] });
+		}
+		return true;
+	}
+
+	// Splits the text into about `count` chunks, moving each boundary forward to the start of a
+	// line so no line is split between two chunks.
+	std::vector<ObjChunk> splitIntoChunks(const char* begin, const char* end, size_t count) {
+		std::vector<ObjChunk> chunks;
+		chunks.reserve(count);
+		const char* chunkBegin{ begin };
+		size_t size{ static_cast<size_t>(end - begin) };
+		for (size_t i{ 1 }; i <= count && chunkBegin < end; ++i) {
+			const char* chunkEnd{ i == count ? end : std::max(chunkBegin, begin + size * i / count) };
+			if (chunkEnd < end) {
+				const char* newline{ static_cast<const char*>(std::memchr(chunkEnd, '\n', end - chunkEnd)) };
+				chunkEnd = newline != nullptr ? newline + 1 : end;
+			}
+			ObjChunk& chunk{ chunks.emplace_back() };
+			chunk.begin = chunkBegin;
+			chunk.end = chunkEnd;
+			chunkBegin = chunkEnd;
+		}
+		return chunks;
+	}
+
+	size_t lineNumber(const char* begin, const char* at) {
+		return std::count(begin, at, '\n') + 1;
+	}
+}
+
+bool parseObj(std::span<const std::byte> text, ThreadPool& pool, std::vector<Vertex3D>& vertices,
+	std::vector<uint32_t>& faces, std::string& error) {
+	const char* begin{ reinterpret_cast<const char*>(text.data()) };
+	const char* end{ begin + text.size() };
+	size_t chunkCount{ std::clamp<size_t>(text.size() / MIN_CHUNK_BYTES, 1, pool.getThreadCount() * 4) };
+	std::vector<ObjChunk> chunks{ splitIntoChunks(begin, end, chunkCount) };
+
+	// First pass: count each chunk's vertices, so every chunk knows where its own go.
+	pool.parallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+		for (size_t i{ first }; i < last; ++i) {
+			ObjChunk& chunk{ chunks[i] };
+			forEachLine(chunk.begin, chunk.end, [&](const char* p, const char* lineEnd) {
+				chunk.vertexCount += isRecord(p, lineEnd, 'v');
+				return true;
+			});
+		}
+	});
+	size_t totalVertices{ 0 };
+	for (ObjChunk& chunk : chunks) {
+		chunk.vertexOffset = totalVertices;
+		totalVertices += chunk.vertexCount;
+	}
+	if (totalVertices > UINT32_MAX) {
+		error = "too many vertices for 32-bit indexes";
+		return false;
+	}
+
+	// Second pass: parse every chunk, writing vertices straight into place and collecting faces.
+	vertices.resize(totalVertices);
+	pool.parallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+		std::vector<uint32_t> corners;
+		for (size_t i{ first }; i < last; ++i) {
+			ObjChunk& chunk{ chunks[i] };
+			size_t vertex{ chunk.vertexOffset };
+			// Most OBJ files have about twice as many faces as vertices.
+			chunk.faces.reserve(chunk.vertexCount * 2 * 3);
+			forEachLine(chunk.begin, chunk.end, [&](const char* p, const char* lineEnd) {
+				if (isRecord(p, lineEnd, 'v')) {
+					if (!parseVertex(p, lineEnd, vertices[vertex++])) {
+						chunk.error = "malformed vertex";
+						chunk.errorAt = p;
+						return false;
+					}
+				}
+				else if (isRecord(p, lineEnd, 'f')) {
+					if (!parseFace(p, lineEnd, vertex, totalVertices, corners, chunk.faces)) {
+						chunk.error = "malformed face, or a face using a vertex that does not exist";
+						chunk.errorAt = p;
+						return false;
+					}
+				}
+				return true;
+			});
+		}
+	});
+	for (const ObjChunk& chunk : chunks) {
+		if (!chunk.error.empty()) {
+			error = chunk.error + " on line " + std::to_string(lineNumber(begin, chunk.errorAt));
+			return false;
+		}
+	}
+
+	// Join the chunks' faces in file order.
+	std::vector<size_t> faceOffsets(chunks.size() + 1, 0);
+	for (size_t i{ 0 }; i < chunks.size(); ++i) {
+		faceOffsets[i + 1] = faceOffsets[i] + chunks[i].faces.size();
+	}
+	faces.resize(faceOffsets.back());
+	pool.parallelFor(chunks.size(), 1, [&](size_t first, size_t last) {
+		for (size_t i{ first }; i < last; ++i) {
+			std::copy(chunks[i].faces.begin(), chunks[i].faces.end(), faces.begin() + faceOffsets[i]);
+		}
+	});
+	return true;
+}
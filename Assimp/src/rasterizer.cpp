@@ -0,0 +1,518 @@
+#include "rasterizer.h"
+#include <algorithm>
+#include <bit>
+#include "trace.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RASTERIZER_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only let a function use AVX2 intrinsics when it is marked for that target, so
+// the rest of the program can still run on CPUs without it. MSVC allows them anywhere.
+#if defined(RASTERIZER_X86) && !defined(_MSC_VER)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace {
+	// A triangle's bounding box in pixels, inclusive, already clamped to some region.
+	struct PixelBounds {
+		int32_t minX;
+		int32_t minY;
+		int32_t maxX;
+		int32_t maxY;
+
+		bool isEmpty() const { return minX > maxX || minY > maxY; }
+	};
+
+	PixelBounds clampedBounds(const ScreenTriangle& triangle, const PixelBounds& region) {
+		return PixelBounds{
+			std::max(std::min({ triangle.a.position.x, triangle.b.position.x, triangle.c.position.x }), region.minX),
+			std::max(std::min({ triangle.a.position.y, triangle.b.position.y, triangle.c.position.y }), region.minY),
+			std::min(std::max({ triangle.a.position.x, triangle.b.position.x, triangle.c.position.x }), region.maxX),
+			std::min(std::max({ triangle.a.position.y, triangle.b.position.y, triangle.c.position.y }), region.maxY)
+		};
+	}
+
+	// Screen coordinates are converted to fixed point with this many fractional bits before the
+	// edge functions are set up. Vertices land on whole pixels and we sample at pixel centres,
+	// so half a pixel is all the precision we need to represent both exactly.
+	const int32_t SUBPIXEL_BITS{ 1 };
+	const int64_t ONE_PIXEL{ 1 << SUBPIXEL_BITS };
+	const int64_t HALF_PIXEL{ ONE_PIXEL / 2 };
+
+	// The 8-wide path evaluates edge functions in 32-bit lanes. Products of two fixed-point
+	// distances stay well inside that range as long as the triangle spans fewer pixels than
+	// this in each direction; bigger triangles use the 64-bit scalar path.
+	const int32_t SIMD_SPAN_LIMIT{ 1 << (14 - SUBPIXEL_BITS) };
+
+	// Twice the signed area of the triangle (a, b, p), in fixed point: positive when p is to
+	// the left of the edge from a to b in screen coordinates.
+	int64_t edgeFunction(int64_t ax, int64_t ay, int64_t bx, int64_t by, int64_t px, int64_t py) {
+		return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+	}
+
+	// Everything needed to walk a triangle's bounding box. The value of each edge function at a
+	// pixel centre is origin + x * stepX + y * stepY, counting x and y from the box's top-left
+	// pixel, so moving one pixel costs one addition per edge.
+	struct EdgeSetup {
+		PixelBounds bounds;
+		int64_t origin[3];
+		int64_t stepX[3];
+		int64_t stepY[3];
+		bool fitsSimd;
+	};
+
+	// Returns false when the triangle is degenerate or misses the region entirely.
+	bool setupEdges(ScreenTriangle triangle, const PixelBounds& region, EdgeSetup& setup) {
+		int64_t area{ edgeFunction(triangle.a.position.x, triangle.a.position.y, triangle.b.position.x, triangle.b.position.y, triangle.c.position.x, triangle.c.position.y) };
+		if (area == 0) {
+			return false;
+		}
+		if (area < 0) {
+			std::swap(triangle.b, triangle.c);
+		}
+		setup.bounds = clampedBounds(triangle, region);
+		if (setup.bounds.isEmpty()) {
+			return false;
+		}
+
+		int64_t spanX{ static_cast<int64_t>(std::max({ triangle.a.position.x, triangle.b.position.x, triangle.c.position.x })) - std::min({ triangle.a.position.x, triangle.b.position.x, triangle.c.position.x }) };
+		int64_t spanY{ static_cast<int64_t>(std::max({ triangle.a.position.y, triangle.b.position.y, triangle.c.position.y })) - std::min({ triangle.a.position.y, triangle.b.position.y, triangle.c.position.y }) };
+		setup.fitsSimd = spanX < SIMD_SPAN_LIMIT && spanY < SIMD_SPAN_LIMIT;
+
+		const sf::Vector2i corners[3]{ triangle.a.position, triangle.b.position, triangle.c.position };
+		int64_t centerX{ setup.bounds.minX * ONE_PIXEL + HALF_PIXEL };
+		int64_t centerY{ setup.bounds.minY * ONE_PIXEL + HALF_PIXEL };
+		for (int edge{ 0 }; edge < 3; ++edge) {
+			int64_t fromX{ corners[edge].x * ONE_PIXEL };
+			int64_t fromY{ corners[edge].y * ONE_PIXEL };
+			int64_t toX{ corners[(edge + 1) % 3].x * ONE_PIXEL };
+			int64_t toY{ corners[(edge + 1) % 3].y * ONE_PIXEL };
+
+			// Top-left rule: a centre exactly on an edge belongs to the triangle only if the edge
+			// is a top edge (horizontal, with the inside below it) or a left edge (the inside to
+			// its right). With our winding, those are the edges that run right along the top or
+			// up the left side. Every other edge is nudged inward by one fixed-point unit, which
+			// turns its ">= 0" test into "> 0".
+			bool topLeft{ (fromY == toY && toX > fromX) || toY < fromY };
+			setup.origin[edge] = edgeFunction(fromX, fromY, toX, toY, centerX, centerY) - (topLeft ? 0 : 1);
+			setup.stepX[edge] = (fromY - toY) * ONE_PIXEL;
+			setup.stepY[edge] = (toX - fromX) * ONE_PIXEL;
+		}
+		return true;
+	}
+
+	// A pixel is covered when no edge function is negative, which is when the sign bit of
+	// their bitwise OR is clear.
+	size_t fillScalar(const EdgeSetup& setup, uint32_t* pixels, size_t stride, uint32_t color) {
+		const PixelBounds& bounds{ setup.bounds };
+		size_t covered{ 0 };
+		int64_t row0{ setup.origin[0] };
+		int64_t row1{ setup.origin[1] };
+		int64_t row2{ setup.origin[2] };
+		for (int32_t y{ bounds.minY }; y <= bounds.maxY; ++y) {
+			uint32_t* row{ pixels + static_cast<size_t>(y) * stride };
+			int64_t e0{ row0 };
+			int64_t e1{ row1 };
+			int64_t e2{ row2 };
+			for (int32_t x{ bounds.minX }; x <= bounds.maxX; ++x) {
+				if ((e0 | e1 | e2) >= 0) {
+					row[x] = color;
+					++covered;
+				}
+				e0 += setup.stepX[0];
+				e1 += setup.stepX[1];
+				e2 += setup.stepX[2];
+			}
+			row0 += setup.stepY[0];
+			row1 += setup.stepY[1];
+			row2 += setup.stepY[2];
+		}
+		return covered;
+	}
+
+#ifdef RASTERIZER_X86
+	// 8 pixels of a row per iteration. Each lane holds one pixel's edge values; the sign bits of
+	// their OR become a coverage mask, and a masked store writes only the covered pixels, so
+	// pixels outside the triangle (or past the end of the bounding box) are never touched.
+	TARGET_AVX2 size_t fillAvx2(const EdgeSetup& setup, uint32_t* pixels, size_t stride, uint32_t color) {
+		const PixelBounds& bounds{ setup.bounds };
+		int32_t width{ bounds.maxX - bounds.minX + 1 };
+		__m256i lanes{ _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) };
+		__m256i allOnes{ _mm256_set1_epi32(-1) };
+		__m256i packed{ _mm256_set1_epi32(static_cast<int32_t>(color)) };
+		__m256i laneOffset[3];
+		__m256i blockStep[3];
+		for (int edge{ 0 }; edge < 3; ++edge) {
+			laneOffset[edge] = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(static_cast<int32_t>(setup.stepX[edge])));
+			blockStep[edge] = _mm256_set1_epi32(static_cast<int32_t>(setup.stepX[edge] * 8));
+		}
+
+		size_t covered{ 0 };
+		int64_t row0{ setup.origin[0] };
+		int64_t row1{ setup.origin[1] };
+		int64_t row2{ setup.origin[2] };
+		for (int32_t y{ bounds.minY }; y <= bounds.maxY; ++y) {
+			int32_t* row{ reinterpret_cast<int32_t*>(pixels + static_cast<size_t>(y) * stride + bounds.minX) };
+			__m256i e0{ _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(row0)), laneOffset[0]) };
+			__m256i e1{ _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(row1)), laneOffset[1]) };
+			__m256i e2{ _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(row2)), laneOffset[2]) };
+			for (int32_t x{ 0 }; x < width; x += 8) {
+				__m256i mask{ _mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(e0, e1), e2), allOnes) };
+				if (width - x < 8) {
+					mask = _mm256_and_si256(mask, _mm256_cmpgt_epi32(_mm256_set1_epi32(width - x), lanes));
+				}
+				unsigned bits{ static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(mask))) };
+				if (bits == 0xFF) {
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(row + x), packed);
+				}
+				else if (bits != 0) {
+					_mm256_maskstore_epi32(row + x, mask, packed);
+				}
+				covered += std::popcount(bits);
+				e0 = _mm256_add_epi32(e0, blockStep[0]);
+				e1 = _mm256_add_epi32(e1, blockStep[1]);
+				e2 = _mm256_add_epi32(e2, blockStep[2]);
+			}
+			row0 += setup.stepY[0];
+			row1 += setup.stepY[1];
+			row2 += setup.stepY[2];
+		}
+		return covered;
+	}
+
+	bool cpuSupportsAvx2() {
+#if defined(_MSC_VER)
+		int info[4]{};
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		__cpuid(info, 1);
+		bool osSavesAvx{ (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6 };
+		__cpuidex(info, 7, 0);
+		bool avx2{ (info[1] & (1 << 5)) != 0 };
+		return osSavesAvx && avx2;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	// Depth varies linearly across a triangle in screen space, so like the edge functions it is
+	// origin + x * stepX + y * stepY at pixel centres, counting from the bounds' top-left pixel.
+	struct DepthPlane {
+		float origin;
+		float stepX;
+		float stepY;
+		float nearest;
+		float farthest;
+	};
+
+	DepthPlane setupDepth(const ScreenTriangle& triangle, const PixelBounds& bounds) {
+		double ax{ static_cast<double>(triangle.a.position.x) };
+		double ay{ static_cast<double>(triangle.a.position.y) };
+		double abX{ triangle.b.position.x - ax };
+		double abY{ triangle.b.position.y - ay };
+		double acX{ triangle.c.position.x - ax };
+		double acY{ triangle.c.position.y - ay };
+		double abZ{ static_cast<double>(triangle.b.depth) - triangle.a.depth };
+		double acZ{ static_cast<double>(triangle.c.depth) - triangle.a.depth };
+		double area{ abX * acY - abY * acX };
+		double stepX{ (abZ * acY - acZ * abY) / area };
+		double stepY{ (acZ * abX - abZ * acX) / area };
+		return DepthPlane{
+			static_cast<float>(triangle.a.depth + stepX * (bounds.minX + 0.5 - ax) + stepY * (bounds.minY + 0.5 - ay)),
+			static_cast<float>(stepX),
+			static_cast<float>(stepY),
+			std::min({ triangle.a.depth, triangle.b.depth, triangle.c.depth }),
+			std::max({ triangle.a.depth, triangle.b.depth, triangle.c.depth })
+		};
+	}
+
+	// Where the depth-tested kernels write, and what.
+	struct DepthTarget {
+		uint32_t* pixels;
+		size_t stride;
+		float* depths;
+		size_t depthStride;
+		uint32_t color;
+	};
+
+	// Fills the covered pixels of one depth block, within the triangle's clamped bounds, that
+	// are nearer than the depth already stored there. When `testDepth` is false the triangle is
+	// known to be nearer than everything in the block, so every covered pixel is written.
+	void fillBlockScalar(const EdgeSetup& setup, const DepthPlane& plane, const DepthTarget& target,
+		int32_t blockX, int32_t blockY, bool testDepth, RasterStats& stats) {
+		const PixelBounds& bounds{ setup.bounds };
+		int32_t minX{ std::max(blockX, bounds.minX) };
+		int32_t maxX{ std::min(blockX + DepthBuffer::BLOCK_SIZE - 1, bounds.maxX) };
+		int32_t minY{ std::max(blockY, bounds.minY) };
+		int32_t maxY{ std::min(blockY + DepthBuffer::BLOCK_SIZE - 1, bounds.maxY) };
+		for (int32_t y{ minY }; y <= maxY; ++y) {
+			uint32_t* row{ target.pixels + static_cast<size_t>(y) * target.stride };
+			float* depthRow{ target.depths + static_cast<size_t>(y) * target.depthStride };
+			int64_t dx{ minX - bounds.minX };
+			int64_t dy{ y - bounds.minY };
+			int64_t e0{ setup.origin[0] + dx * setup.stepX[0] + dy * setup.stepY[0] };
+			int64_t e1{ setup.origin[1] + dx * setup.stepX[1] + dy * setup.stepY[1] };
+			int64_t e2{ setup.origin[2] + dx * setup.stepX[2] + dy * setup.stepY[2] };
+			// Depth is computed from the block's first column exactly as the AVX2 kernel does,
+			// so both paths produce the same image.
+			int64_t blockDx{ blockX - bounds.minX };
+			float rowZ{ plane.origin + blockDx * plane.stepX + dy * plane.stepY };
+			for (int32_t x{ minX }; x <= maxX; ++x) {
+				float z{ rowZ + static_cast<float>(x - blockX) * plane.stepX };
+				if ((e0 | e1 | e2) >= 0) {
+					++stats.pixelsTested;
+					if (!testDepth || z < depthRow[x]) {
+						row[x] = target.color;
+						depthRow[x] = z;
+						++stats.pixelsWritten;
+					}
+				}
+				e0 += setup.stepX[0];
+				e1 += setup.stepX[1];
+				e2 += setup.stepX[2];
+			}
+		}
+	}
+
+#ifdef RASTERIZER_X86
+	// One row of the block per iteration: the block is exactly 8 pixels wide, so each row is a
+	// single vector of coverage, depth comparison, and masked stores.
+	TARGET_AVX2 void fillBlockAvx2(const EdgeSetup& setup, const DepthPlane& plane, const DepthTarget& target,
+		int32_t blockX, int32_t blockY, bool testDepth, RasterStats& stats) {
+		static_assert(DepthBuffer::BLOCK_SIZE == 8, "one block row must fill one AVX2 register");
+		const PixelBounds& bounds{ setup.bounds };
+		__m256i lanes{ _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) };
+		__m256 laneOffsets{ _mm256_cvtepi32_ps(lanes) };
+		__m256i allOnes{ _mm256_set1_epi32(-1) };
+		__m256i packed{ _mm256_set1_epi32(static_cast<int32_t>(target.color)) };
+		// Columns outside the bounds may still be inside the triangle, but belong to another
+		// tile or lie off screen.
+		__m256i columns{ _mm256_and_si256(
+			_mm256_cmpgt_epi32(lanes, _mm256_set1_epi32(bounds.minX - blockX - 1)),
+			_mm256_cmpgt_epi32(_mm256_set1_epi32(bounds.maxX - blockX + 1), lanes)) };
+		__m256i laneOffset[3];
+		for (int edge{ 0 }; edge < 3; ++edge) {
+			laneOffset[edge] = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(static_cast<int32_t>(setup.stepX[edge])));
+		}
+		__m256 zOffset{ _mm256_mul_ps(laneOffsets, _mm256_set1_ps(plane.stepX)) };
+
+		int32_t minY{ std::max(blockY, bounds.minY) };
+		int32_t maxY{ std::min(blockY + DepthBuffer::BLOCK_SIZE - 1, bounds.maxY) };
+		int64_t dx{ blockX - bounds.minX };
+		for (int32_t y{ minY }; y <= maxY; ++y) {
+			int64_t dy{ y - bounds.minY };
+			__m256i e0{ _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(setup.origin[0] + dx * setup.stepX[0] + dy * setup.stepY[0])), laneOffset[0]) };
+			__m256i e1{ _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(setup.origin[1] + dx * setup.stepX[1] + dy * setup.stepY[1])), laneOffset[1]) };
+			__m256i e2{ _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(setup.origin[2] + dx * setup.stepX[2] + dy * setup.stepY[2])), laneOffset[2]) };
+			__m256i covered{ _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(e0, e1), e2), allOnes), columns) };
+			unsigned coveredBits{ static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(covered))) };
+			if (coveredBits == 0) {
+				continue;
+			}
+
+			float* depthRow{ target.depths + static_cast<size_t>(y) * target.depthStride + blockX };
+			__m256 z{ _mm256_add_ps(_mm256_set1_ps(plane.origin + dx * plane.stepX + dy * plane.stepY), zOffset) };
+			__m256i pass{ covered };
+			if (testDepth) {
+				pass = _mm256_and_si256(pass, _mm256_castps_si256(_mm256_cmp_ps(z, _mm256_loadu_ps(depthRow), _CMP_LT_OQ)));
+			}
+			unsigned passBits{ static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(pass))) };
+			if (passBits != 0) {
+				uint32_t* row{ target.pixels + static_cast<size_t>(y) * target.stride + blockX };
+				_mm256_maskstore_epi32(reinterpret_cast<int32_t*>(row), pass, packed);
+				_mm256_maskstore_ps(depthRow, pass, z);
+			}
+			stats.pixelsTested += std::popcount(coveredBits);
+			stats.pixelsWritten += std::popcount(passBits);
+		}
+	}
+#endif
+
+	// Fills the part of a triangle that lies inside `region`, one depth block at a time. Blocks
+	// where the triangle's nearest corner is no nearer than the farthest depth already stored
+	// are rejected without looking at their pixels.
+	void fillTriangleDepth(const DepthTarget& target, DepthBuffer& depthBuffer, const ScreenTriangle& triangle,
+		const PixelBounds& region, RasterPath path, RasterStats& stats) {
+		EdgeSetup setup;
+		if (!setupEdges(triangle, region, setup)) {
+			return;
+		}
+		DepthPlane plane{ setupDepth(triangle, setup.bounds) };
+		const int32_t BLOCK_SIZE{ DepthBuffer::BLOCK_SIZE };
+
+		bool anyBlockDrawn{ false };
+		for (int32_t blockY{ setup.bounds.minY / BLOCK_SIZE }; blockY <= setup.bounds.maxY / BLOCK_SIZE; ++blockY) {
+			for (int32_t blockX{ setup.bounds.minX / BLOCK_SIZE }; blockX <= setup.bounds.maxX / BLOCK_SIZE; ++blockX) {
+				DepthBlock& block{ depthBuffer.block(blockX, blockY) };
+				if (plane.nearest >= block.farthest) {
+					++stats.blocksRejected;
+					continue;
+				}
+				anyBlockDrawn = true;
+
+				size_t written{ stats.pixelsWritten };
+				bool testDepth{ plane.farthest >= block.nearest };
+#ifdef RASTERIZER_X86
+				if (path == RasterPath::AVX2 && setup.fitsSimd) {
+					fillBlockAvx2(setup, plane, target, blockX * BLOCK_SIZE, blockY * BLOCK_SIZE, testDepth, stats);
+				}
+				else
+#endif
+				{
+					fillBlockScalar(setup, plane, target, blockX * BLOCK_SIZE, blockY * BLOCK_SIZE, testDepth, stats);
+				}
+				if (stats.pixelsWritten != written) {
+					depthBuffer.refreshBlock(blockX, blockY);
+				}
+			}
+		}
+		if (!anyBlockDrawn) {
+			++stats.trianglesRejected;
+		}
+	}
+
+	// Fills the part of a triangle that lies inside `region`, and returns how many pixels it wrote.
+	size_t fillTriangle(uint32_t* pixels, size_t stride, const ScreenTriangle& triangle,
+		const PixelBounds& region, uint32_t color, RasterPath path) {
+		EdgeSetup setup;
+		if (!setupEdges(triangle, region, setup)) {
+			return 0;
+		}
+#ifdef RASTERIZER_X86
+		if (path == RasterPath::AVX2 && setup.fitsSimd) {
+			return fillAvx2(setup, pixels, stride, color);
+		}
+#endif
+		return fillScalar(setup, pixels, stride, color);
+	}
+}
+
+RasterPath detectRasterPath() {
+#ifdef RASTERIZER_X86
+	static const RasterPath path{ cpuSupportsAvx2() ? RasterPath::AVX2 : RasterPath::Scalar };
+	return path;
+#else
+	return RasterPath::Scalar;
+#endif
+}
+
+const char* rasterPathName(RasterPath path) {
+	return path == RasterPath::AVX2 ? "AVX2" : "scalar";
+}
+
+size_t fillTriangle(Framebuffer& framebuffer, sf::Vector2i a, sf::Vector2i b, sf::Vector2i c,
+	sf::Color color, RasterPath path) {
+	sf::Vector2u size{ framebuffer.getSize() };
+	PixelBounds screen{ 0, 0, static_cast<int32_t>(size.x) - 1, static_cast<int32_t>(size.y) - 1 };
+	return fillTriangle(framebuffer.data(), size.x, ScreenTriangle{ { a, 0.0f }, { b, 0.0f }, { c, 0.0f } }, screen, Framebuffer::pack(color), path);
+}
+
+size_t fillTriangle(Framebuffer& framebuffer, sf::Vector2i a, sf::Vector2i b, sf::Vector2i c, sf::Color color) {
+	return fillTriangle(framebuffer, a, b, c, color, detectRasterPath());
+}
+
+RasterStats& RasterStats::operator+=(const RasterStats& other) {
+	pixelsTested += other.pixelsTested;
+	pixelsWritten += other.pixelsWritten;
+	blocksRejected += other.blocksRejected;
+	trianglesRejected += other.trianglesRejected;
+	return *this;
+}
+
+void TileRasterizer::draw(Framebuffer& framebuffer, ThreadPool& pool,
+	const std::vector<ScreenTriangle>& triangles, sf::Color color) {
+	drawTiles(framebuffer, nullptr, pool, triangles, color);
+}
+
+void TileRasterizer::draw(Framebuffer& framebuffer, DepthBuffer& depthBuffer, ThreadPool& pool,
+	const std::vector<ScreenTriangle>& triangles, sf::Color color) {
+	drawTiles(framebuffer, &depthBuffer, pool, triangles, color);
+}
+
+void TileRasterizer::drawTiles(Framebuffer& framebuffer, DepthBuffer* depthBuffer, ThreadPool& pool,
+	const std::vector<ScreenTriangle>& triangles, sf::Color color) {
+	// Tiles must cover whole depth blocks, so that no block is shared by two threads.
+	static_assert(TILE_SIZE % DepthBuffer::BLOCK_SIZE == 0);
+	resize(framebuffer.getSize());
+	{
+		TRACE_SPAN("bin");
+		bin(triangles);
+	}
+
+	DepthTarget target{
+		framebuffer.data(),
+		m_framebufferSize.x,
+		depthBuffer != nullptr ? depthBuffer->data() : nullptr,
+		depthBuffer != nullptr ? depthBuffer->getStride() : 0,
+		Framebuffer::pack(color)
+	};
+	RasterPath path{ detectRasterPath() };
+	pool.parallelFor(m_bins.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t tile{ begin }; tile < end; ++tile) {
+			int32_t tileX{ static_cast<int32_t>(tile % m_tilesX) * TILE_SIZE };
+			int32_t tileY{ static_cast<int32_t>(tile / m_tilesX) * TILE_SIZE };
+			PixelBounds region{
+				tileX,
+				tileY,
+				std::min(tileX + TILE_SIZE, static_cast<int32_t>(m_framebufferSize.x)) - 1,
+				std::min(tileY + TILE_SIZE, static_cast<int32_t>(m_framebufferSize.y)) - 1
+			};
+			RasterStats stats{};
+			for (uint32_t index : m_bins[tile]) {
+				if (depthBuffer != nullptr) {
+					fillTriangleDepth(target, *depthBuffer, triangles[index], region, path, stats);
+				}
+				else {
+					size_t written{ fillTriangle(target.pixels, target.stride, triangles[index], region, target.color, path) };
+					stats.pixelsTested += written;
+					stats.pixelsWritten += written;
+				}
+			}
+			m_tileStats[tile] = stats;
+		}
+	});
+
+	for (const RasterStats& stats : m_tileStats) {
+		m_stats += stats;
+	}
+}
+
+void TileRasterizer::resize(sf::Vector2u framebufferSize) {
+	if (framebufferSize == m_framebufferSize) {
+		return;
+	}
+	m_framebufferSize = framebufferSize;
+	m_tilesX = static_cast<int32_t>((framebufferSize.x + TILE_SIZE - 1) / TILE_SIZE);
+	m_tilesY = static_cast<int32_t>((framebufferSize.y + TILE_SIZE - 1) / TILE_SIZE);
+	m_bins.assign(static_cast<size_t>(m_tilesX) * m_tilesY, {});
+	m_tileStats.assign(m_bins.size(), RasterStats{});
+}
+
+void TileRasterizer::bin(const std::vector<ScreenTriangle>& triangles) {
+	for (std::vector<uint32_t>& bin : m_bins) {
+		bin.clear();
+	}
+
+	PixelBounds screen{ 0, 0, static_cast<int32_t>(m_framebufferSize.x) - 1, static_cast<int32_t>(m_framebufferSize.y) - 1 };
+	for (size_t i{ 0 }; i < triangles.size(); ++i) {
+		PixelBounds bounds{ clampedBounds(triangles[i], screen) };
+		if (bounds.isEmpty()) {
+			continue;
+		}
+		for (int32_t tileY{ bounds.minY / TILE_SIZE }; tileY <= bounds.maxY / TILE_SIZE; ++tileY) {
+			for (int32_t tileX{ bounds.minX / TILE_SIZE }; tileX <= bounds.maxX / TILE_SIZE; ++tileX) {
+				m_bins[static_cast<size_t>(tileY) * m_tilesX + tileX].push_back(static_cast<uint32_t>(i));
+			}
+		}
+	}
+}
@@ -0,0 +1,210 @@
+#include "scene_import.h"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <chrono>
+#include <iostream>
+#include <utility>
+#include "trace.h"
+
+namespace {
+	struct PostProcessStep {
+		unsigned int flag;
+		const char* name;
+	};
+
+	// Assimp's post-processing steps, in approximately the order its importer runs them when
+	// several are requested at once, so each can be timed on its own. The result is not always the
+	// same scene a single call would produce. Assimp runs SplitLargeMeshes as two passes, splitting
+	// by triangle count before normals are generated and by vertex count after identical vertices
+	// are joined; its one flag runs both here, before the join. Steps this list does not name, such
+	// as ArmaturePopulate, run together at the end.
+	const PostProcessStep POST_PROCESS_STEPS[]{
+		{ aiProcess_ValidateDataStructure, "validate data structure" },
+		{ aiProcess_MakeLeftHanded, "make left-handed" },
+		{ aiProcess_FlipUVs, "flip UVs" },
+		{ aiProcess_FlipWindingOrder, "flip winding order" },
+		{ aiProcess_RemoveComponent, "remove components" },
+		{ aiProcess_RemoveRedundantMaterials, "remove redundant materials" },
+		{ aiProcess_EmbedTextures, "embed textures" },
+		{ aiProcess_FindInstances, "find instances" },
+		{ aiProcess_OptimizeGraph, "optimize graph" },
+		{ aiProcess_FindDegenerates, "find degenerates" },
+		{ aiProcess_GenUVCoords, "generate UV coordinates" },
+		{ aiProcess_TransformUVCoords, "transform UV coordinates" },
+		{ aiProcess_GlobalScale, "global scale" },
+		{ aiProcess_PreTransformVertices, "pre-transform vertices" },
+		{ aiProcess_Triangulate, "triangulate" },
+		{ aiProcess_SortByPType, "sort by primitive type" },
+		{ aiProcess_FindInvalidData, "find invalid data" },
+		{ aiProcess_OptimizeMeshes, "optimize meshes" },
+		{ aiProcess_FixInfacingNormals, "fix infacing normals" },
+		{ aiProcess_SplitByBoneCount, "split by bone count" },
+		{ aiProcess_SplitLargeMeshes, "split large meshes" },
+		{ aiProcess_GenNormals, "generate normals" },
+		{ aiProcess_GenSmoothNormals, "generate smooth normals" },
+		{ aiProcess_CalcTangentSpace, "calculate tangent space" },
+		{ aiProcess_JoinIdenticalVertices, "join identical vertices" },
+		{ aiProcess_Debone, "debone" },
+		{ aiProcess_LimitBoneWeights, "limit bone weights" },
+		{ aiProcess_ImproveCacheLocality, "improve cache locality" },
+		{ aiProcess_GenBoundingBoxes, "generate bounding boxes" }
+	};
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void failImport(const Assimp::Importer& importer) {
+		std::cout << "ASSIMP ERROR" << importer.GetErrorString() << std::endl;
+		exit(1);
+	}
+
+	// Assimp's matrices are 4x4 and row-major, with the translation in the last column; the bottom
+	// row of an affine matrix is always 0 0 0 1, so it is dropped.
+	AffineTransform toAffine(const aiMatrix4x4& matrix) {
+		return AffineTransform{ {
+			{ matrix.a1, matrix.a2, matrix.a3, matrix.a4 },
+			{ matrix.b1, matrix.b2, matrix.b3, matrix.b4 },
+			{ matrix.c1, matrix.c2, matrix.c3, matrix.c4 }
+		} };
+	}
+
+	// The transform that applies `first`, then `second`.
+	AffineTransform multiply(const AffineTransform& second, const AffineTransform& first) {
+		AffineTransform result{};
+		for (int row{ 0 }; row < 3; ++row) {
+			for (int col{ 0 }; col < 4; ++col) {
+				result.m[row][col] = second.m[row][0] * first.m[0][col]
+					+ second.m[row][1] * first.m[1][col]
+					+ second.m[row][2] * first.m[2][col];
+			}
+			result.m[row][3] += second.m[row][3];
+		}
+		return result;
+	}
+
+	Vertex3D apply(const AffineTransform& transform, const Vertex3D& vertex) {
+		const auto& m{ transform.m };
+		return Vertex3D{
+			m[0][0] * vertex.x + m[0][1] * vertex.y + m[0][2] * vertex.z + m[0][3],
+			m[1][0] * vertex.x + m[1][1] * vertex.y + m[1][2] * vertex.z + m[1][3],
+			m[2][0] * vertex.x + m[2][1] * vertex.y + m[2][2] * vertex.z + m[2][3]
+		};
+	}
+
+	// Appends one mesh's positions and triangles to the scene's arrays.
+	void appendMesh(const aiMesh* mesh, ImportedScene& scene) {
+		MeshRange& range{ scene.meshes.emplace_back() };
+		range.name = mesh->mName.C_Str();
+		range.firstVertex = static_cast<uint32_t>(scene.vertices.size());
+		range.vertexCount = mesh->mNumVertices;
+		range.firstIndex = static_cast<uint32_t>(scene.indices.size());
+
+		for (size_t i{ 0 }; i < mesh->mNumVertices; ++i) {
+			const aiVector3D& position{ mesh->mVertices[i] };
+			scene.vertices.push_back(Vertex3D{ position.x, position.y, position.z });
+		}
+		for (size_t i{ 0 }; i < mesh->mNumFaces; ++i) {
+			const aiFace& face{ mesh->mFaces[i] };
+			if (face.mNumIndices != 3) {
+				++scene.skippedPrimitives;
+				continue;
+			}
+			scene.indices.insert(scene.indices.end(), { face.mIndices[0], face.mIndices[1], face.mIndices[2] });
+		}
+		range.indexCount = static_cast<uint32_t>(scene.indices.size()) - range.firstIndex;
+	}
+}
+
+ImportedScene importScene(const std::string& path, unsigned int flags) {
+	TRACE_SPAN("importScene");
+	ImportedScene result;
+	Assimp::Importer importer;
+
+	auto start{ std::chrono::steady_clock::now() };
+	const aiScene* scene{ nullptr };
+	{
+		TRACE_SPAN("read");
+		scene = importer.ReadFile(path, 0);
+	}
+	if (scene == nullptr) {
+		failImport(importer);
+	}
+	result.steps.push_back(ImportStepTime{ "read", millisecondsSince(start) });
+
+	auto runStep{ [&](unsigned int stepFlags, const char* name) {
+		TRACE_SPAN(name);
+		auto stepStart{ std::chrono::steady_clock::now() };
+		scene = importer.ApplyPostProcessing(stepFlags);
+		if (scene == nullptr) {
+			failImport(importer);
+		}
+		result.steps.push_back(ImportStepTime{ name, millisecondsSince(stepStart) });
+	} };
+	unsigned int remaining{ flags };
+	for (const PostProcessStep& step : POST_PROCESS_STEPS) {
+		if ((remaining & step.flag) != 0) {
+			runStep(step.flag, step.name);
+			remaining &= ~step.flag;
+		}
+	}
+	// Flags this list does not know about, such as ones added by a newer Assimp.
+	if (remaining != 0) {
+		runStep(remaining, "other steps");
+	}
+
+	TRACE_SPAN("gather meshes");
+	size_t vertexCount{ 0 };
+	size_t indexCount{ 0 };
+	for (size_t i{ 0 }; i < scene->mNumMeshes; ++i) {
+		vertexCount += scene->mMeshes[i]->mNumVertices;
+		indexCount += scene->mMeshes[i]->mNumFaces * 3;
+	}
+	result.vertices.reserve(vertexCount);
+	result.indices.reserve(indexCount);
+	result.meshes.reserve(scene->mNumMeshes);
+	for (size_t i{ 0 }; i < scene->mNumMeshes; ++i) {
+		appendMesh(scene->mMeshes[i], result);
+	}
+
+	// Walk the node tree without recursion, as some exporters nest nodes very deeply.
+	std::vector<std::pair<const aiNode*, AffineTransform>> pending;
+	if (scene->mRootNode != nullptr) {
+		pending.emplace_back(scene->mRootNode, toAffine(scene->mRootNode->mTransformation));
+	}
+	while (!pending.empty()) {
+		auto [node, transform] { pending.back() };
+		pending.pop_back();
+		for (size_t i{ 0 }; i < node->mNumMeshes; ++i) {
+			result.instances.push_back(MeshInstance{ node->mMeshes[i], transform });
+		}
+		for (size_t i{ 0 }; i < node->mNumChildren; ++i) {
+			const aiNode* child{ node->mChildren[i] };
+			pending.emplace_back(child, multiply(transform, toAffine(child->mTransformation)));
+		}
+	}
+	return result;
+}
+
+void flattenScene(const ImportedScene& scene, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces) {
+	TRACE_SPAN("flattenScene");
+	size_t vertexCount{ vertices.size() };
+	size_t indexCount{ faces.size() };
+	for (const MeshInstance& instance : scene.instances) {
+		vertexCount += scene.meshes[instance.mesh].vertexCount;
+		indexCount += scene.meshes[instance.mesh].indexCount;
+	}
+	vertices.reserve(vertexCount);
+	faces.reserve(indexCount);
+
+	for (const MeshInstance& instance : scene.instances) {
+		const MeshRange& mesh{ scene.meshes[instance.mesh] };
+		uint32_t base{ static_cast<uint32_t>(vertices.size()) };
+		for (uint32_t i{ 0 }; i < mesh.vertexCount; ++i) {
+			vertices.push_back(apply(instance.transform, scene.vertices[mesh.firstVertex + i]));
+		}
+		for (uint32_t i{ 0 }; i < mesh.indexCount; ++i) {
+			faces.push_back(base + scene.indices[mesh.firstIndex + i]);
+		}
+	}
+}
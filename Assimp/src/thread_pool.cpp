@@ -0,0 +1,92 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <string>
+#include "trace.h"
+
+ThreadPool::ThreadPool(size_t threadCount) {
+	// hardware_concurrency() may report 0 when it cannot tell.
+	size_t workerCount{ std::max<size_t>(threadCount, 1) - 1 };
+	m_workers.reserve(workerCount);
+	for (size_t i{ 0 }; i < workerCount; ++i) {
+		m_workers.emplace_back([this, i] {
+			nameTraceThread("worker " + std::to_string(i + 1));
+			workerLoop();
+		});
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard lock{ m_mutex };
+		m_stopping = true;
+	}
+	m_workReady.notify_all();
+	for (std::thread& worker : m_workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, size_t minChunkSize,
+	const std::function<void(size_t, size_t)>& body) {
+	if (count == 0) {
+		return;
+	}
+	// A few chunks per thread lets threads that finish early pick up the slack.
+	size_t chunkSize{ std::max<size_t>({ minChunkSize, 1, count / (getThreadCount() * 4) }) };
+	if (m_workers.empty() || chunkSize >= count) {
+		body(0, count);
+		return;
+	}
+
+	{
+		std::lock_guard lock{ m_mutex };
+		m_body = &body;
+		m_count = count;
+		m_chunkSize = chunkSize;
+		m_chunkCount = (count + chunkSize - 1) / chunkSize;
+		m_nextChunk = 0;
+		m_busyWorkers = m_workers.size();
+		++m_generation;
+	}
+	m_workReady.notify_all();
+
+	runChunks();
+
+	std::unique_lock lock{ m_mutex };
+	m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+	m_body = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+	size_t seenGeneration{ 0 };
+	while (true) {
+		{
+			std::unique_lock lock{ m_mutex };
+			m_workReady.wait(lock, [&] { return m_stopping || m_generation != seenGeneration; });
+			if (m_stopping) {
+				return;
+			}
+			seenGeneration = m_generation;
+		}
+
+		runChunks();
+
+		{
+			std::lock_guard lock{ m_mutex };
+			--m_busyWorkers;
+		}
+		m_workDone.notify_one();
+	}
+}
+
+void ThreadPool::runChunks() {
+	while (true) {
+		size_t chunk{ m_nextChunk.fetch_add(1) };
+		if (chunk >= m_chunkCount) {
+			return;
+		}
+		size_t begin{ chunk * m_chunkSize };
+		TRACE_SPAN("chunk");
+		(*m_body)(begin, std::min(begin + m_chunkSize, m_count));
+	}
+}
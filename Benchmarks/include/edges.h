@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Builds the list of unique edges in a triangle mesh from its face indexes, as pairs of vertex
+// indexes of the same width as the faces'. In a closed mesh almost every edge is shared by two
+// faces; listing it once means a wireframe drawn from the edge list rasterizes each line once
+// instead of twice.
+std::vector<uint16_t> extractEdges(std::span<const uint16_t> faces);
+std::vector<uint32_t> extractEdges(std::span<const uint32_t> faces);
@@ -0,0 +1,83 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cmath>
+#include <cstdint>
+#include "Mesh.h"
+
+// The per-vertex stages of the LocalSpace pipeline, in the order a vertex passes through them,
+// copied here so each one can be timed on its own. Keep them in step with LocalSpace's main.cpp.
+// They are defined inline, as they are in the demo, so the compiler can optimize each benchmark
+// loop the same way it optimizes drawMesh.
+
+// Parameters to define the viewing frustum.
+struct Frustum {
+	float near;
+	float far;
+	float left;
+	float right;
+	float bottom;
+	float top;
+};
+
+// Transforms from local coordinates to world coordinates.
+inline Vertex3D localToWorld(
+	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale,
+	const Vertex3D& vertex) {
+	// Rotate, then scale, then translate.
+	// When rotating, we first yaw, then pitch, then roll.
+	float yawX{ vertex.x * std::cos(orientation.y) + vertex.z * std::sin(orientation.y) };
+	float yawY{ vertex.y };
+	float yawZ{ -vertex.x * std::sin(orientation.y) + vertex.z * std::cos(orientation.y) };
+
+	float pitchX{ yawX };
+	float pitchY{ yawY * std::cos(orientation.x) - yawZ * std::sin(orientation.x) };
+	float pitchZ{ yawY * std::sin(orientation.x) + yawZ * std::cos(orientation.x) };
+
+	float rollX{ pitchX * std::cos(orientation.z) - pitchY * std::sin(orientation.z) };
+	float rollY{ pitchX * std::sin(orientation.z) + pitchY * std::cos(orientation.z) };
+	float rollZ{ pitchZ };
+
+	return Vertex3D{ rollX * scale.x + position.x, rollY * scale.y + position.y, rollZ * scale.z + position.z };
+}
+
+// Transforms from world coordinates to view coordinates, by undoing the camera's translation and
+// then its orientation.
+inline Vertex3D worldToView(const sf::Vector3f& cameraPosition, const sf::Vector3f& cameraOrientation, const Vertex3D& vertex) {
+	sf::Vector3f cOrientation{ -cameraOrientation };
+
+	float translateX{ vertex.x - cameraPosition.x };
+	float translateY{ vertex.y - cameraPosition.y };
+	float translateZ{ vertex.z - cameraPosition.z };
+
+	float rollX{ translateX * std::cos(cOrientation.z) - translateY * std::sin(cOrientation.z) };
+	float rollY{ translateX * std::sin(cOrientation.z) + translateY * std::cos(cOrientation.z) };
+	float rollZ{ translateZ };
+
+	float pitchX{ rollX };
+	float pitchY{ rollY * std::cos(cOrientation.x) - rollZ * std::sin(cOrientation.x) };
+	float pitchZ{ rollY * std::sin(cOrientation.x) + rollZ * std::cos(cOrientation.x) };
+
+	float yawX{ pitchX * std::cos(cOrientation.y) + pitchZ * std::sin(cOrientation.y) };
+	float yawY{ pitchY };
+	float yawZ{ -pitchX * std::sin(cOrientation.y) + pitchZ * std::cos(cOrientation.y) };
+
+	return Vertex3D{ yawX, yawY, yawZ };
+}
+
+// Transform from view coordinates to clip coordinates.
+inline Vertex3D viewToClip(const Frustum& frustum, const Vertex3D& view) {
+	float xp{ view.x * -frustum.near / view.z };
+	float yp{ view.y * -frustum.near / view.z };
+	float xClip{ xp / frustum.right };
+	float yClip{ yp / frustum.top };
+	float zClip{ (frustum.far + frustum.near) / (frustum.far - frustum.near)
+		+ 2 * frustum.far * frustum.near / ((frustum.far - frustum.near) * view.z) };
+	return Vertex3D{ xClip, yClip, zClip };
+}
+
+// Linear interpolate from clip coordinates to screen coordinates.
+inline sf::Vector2i clipToScreen(const sf::View& viewport, const Vertex3D& clip) {
+	int32_t xs{ static_cast<int32_t>(viewport.getSize().x * (clip.x + 1) / 2.0) };
+	int32_t ys{ static_cast<int32_t>(viewport.getSize().y - viewport.getSize().y * (clip.y + 1) / 2.0) };
+	return sf::Vector2i{ xs, ys };
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include "framebuffer.h"
+#include "lines.h"
+void drawTriangle(sf::RenderWindow& window, sf::Vector2i a, sf::Vector2i b, sf::Vector2i c, sf::Color color);
+void drawTriangle(Framebuffer& framebuffer, sf::Vector2i a, sf::Vector2i b, sf::Vector2i c, sf::Color color);
+void drawTriangle(LineBatch& batch, sf::Vector2i a, sf::Vector2i b, sf::Vector2i c, sf::Color color);
@@ -0,0 +1,43 @@
+#include "edges.h"
+#include <algorithm>
+
+namespace {
+	template <typename Index>
+	std::vector<Index> extractEdgesOf(std::span<const Index> faces) {
+		// Each edge becomes a 64-bit key holding its smaller vertex index in the high half and its
+		// larger index in the low half, so the two faces sharing an edge produce the same key no
+		// matter which way they wind. Sorting brings duplicates next to each other, where unique()
+		// removes them; this works on one flat array, so it scales to meshes with millions of faces.
+		std::vector<uint64_t> keys{};
+		keys.reserve(faces.size());
+		auto addEdge{ [&keys](Index a, Index b) {
+			uint64_t low{ std::min(a, b) };
+			uint64_t high{ std::max(a, b) };
+			keys.push_back((low << 32) | high);
+		} };
+		for (size_t i{ 0 }; i + 2 < faces.size(); i = i + 3) {
+			addEdge(faces[i], faces[i + 1]);
+			addEdge(faces[i + 1], faces[i + 2]);
+			addEdge(faces[i + 2], faces[i]);
+		}
+
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+		std::vector<Index> edges{};
+		edges.reserve(keys.size() * 2);
+		for (uint64_t key : keys) {
+			edges.push_back(static_cast<Index>(key >> 32));
+			edges.push_back(static_cast<Index>(key));
+		}
+		return edges;
+	}
+}
+
+std::vector<uint16_t> extractEdges(std::span<const uint16_t> faces) {
+	return extractEdgesOf(faces);
+}
+
+std::vector<uint32_t> extractEdges(std::span<const uint32_t> faces) {
+	return extractEdgesOf(faces);
+}
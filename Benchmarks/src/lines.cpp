@@ -0,0 +1,147 @@
+#include "lines.h"
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+
+
+void drawPixel(sf::RenderWindow& window, sf::Vector2i position, sf::Color color) {
+	float pX{ static_cast<float>(position.x) };
+	float pY{ static_cast<float>(position.y) };
+
+	std::array<sf::Vertex, 1> pixel{
+		sf::Vertex{
+			sf::Vector2f{pX, pY},
+			color
+		}
+	};
+	window.draw(pixel.data(), 1, sf::PrimitiveType::Points);
+}
+
+// This version of drawLine uses SFML to more-efficiently draw the line, instead of using repeated
+// calls to our drawPixel.
+// SFML uses Bresenham's algorithm like us; but they avoid the overhead of multiple "draw a pixel"
+// calls because they have low-level access to the framebuffer.
+// You can replace this method with your Bresenham's algorithms from Homework 1; the demo will run
+// slower, but it will more truly be *your* own work.
+void drawLine(sf::RenderWindow& window, sf::Vector2i start, sf::Vector2i end, sf::Color color) {
+	float sX{ static_cast<float>(start.x) };
+	float sY{ static_cast<float>(start.y) };
+	float eX{ static_cast<float>(end.x) };
+	float eY{ static_cast<float>(end.y) };
+	std::array<sf::Vertex, 2> points{
+		sf::Vertex{sf::Vector2f{sX, sY}, color},
+		sf::Vertex{sf::Vector2f{eX, eY}, color}
+	};
+	window.draw(points.data(), 2, sf::PrimitiveType::Lines);
+}
+
+void drawPixel(Framebuffer& framebuffer, sf::Vector2i position, sf::Color color) {
+	framebuffer.setPixel(position.x, position.y, Framebuffer::pack(color));
+}
+
+namespace {
+	// Liang-Barsky: shortens the line to the part that lies on the framebuffer, so Bresenham's loop
+	// never walks pixels that would only be skipped, however far off screen the ends are. Returns
+	// false if none of the line is on the framebuffer.
+	bool clipToFramebuffer(sf::Vector2i& start, sf::Vector2i& end, sf::Vector2u size) {
+		if (size.x == 0 || size.y == 0) {
+			return false;
+		}
+		double dx{ static_cast<double>(end.x) - start.x };
+		double dy{ static_cast<double>(end.y) - start.y };
+		// The line is start + t * (end - start) for t from 0 to 1. Each edge of the framebuffer
+		// limits t to one side of the point where the line crosses it: p * t <= q.
+		std::array<double, 4> p{ -dx, dx, -dy, dy };
+		std::array<double, 4> q{
+			static_cast<double>(start.x), size.x - 1.0 - start.x,
+			static_cast<double>(start.y), size.y - 1.0 - start.y
+		};
+		double enter{ 0.0 };
+		double exit{ 1.0 };
+		for (size_t i{ 0 }; i < p.size(); ++i) {
+			if (p[i] == 0.0) {
+				// Parallel to this edge, so either entirely outside it or never crossing it.
+				if (q[i] < 0.0) {
+					return false;
+				}
+			}
+			else if (p[i] < 0.0) {
+				enter = std::max(enter, q[i] / p[i]);
+			}
+			else {
+				exit = std::min(exit, q[i] / p[i]);
+			}
+		}
+		if (enter > exit) {
+			return false;
+		}
+
+		// Lines already on the framebuffer keep their exact ends, and so their exact pixels.
+		auto pointAt{ [&](double t) {
+			int32_t x{ static_cast<int32_t>(std::lround(start.x + t * dx)) };
+			int32_t y{ static_cast<int32_t>(std::lround(start.y + t * dy)) };
+			return sf::Vector2i{ std::clamp(x, 0, static_cast<int32_t>(size.x) - 1),
+				std::clamp(y, 0, static_cast<int32_t>(size.y) - 1) };
+		} };
+		sf::Vector2i clippedStart{ enter > 0.0 ? pointAt(enter) : start };
+		sf::Vector2i clippedEnd{ exit < 1.0 ? pointAt(exit) : end };
+		start = clippedStart;
+		end = clippedEnd;
+		return true;
+	}
+}
+
+// Bresenham's algorithm, generalized to all eight octants, writing straight into the framebuffer.
+// The line is clipped to the framebuffer first, so only pixels on screen are visited.
+void drawLine(Framebuffer& framebuffer, sf::Vector2i start, sf::Vector2i end, sf::Color color) {
+	if (!clipToFramebuffer(start, end, framebuffer.getSize())) {
+		return;
+	}
+	std::uint32_t packed{ Framebuffer::pack(color) };
+
+	int32_t dx{ std::abs(end.x - start.x) };
+	int32_t dy{ -std::abs(end.y - start.y) };
+	int32_t stepX{ start.x < end.x ? 1 : -1 };
+	int32_t stepY{ start.y < end.y ? 1 : -1 };
+	int32_t error{ dx + dy };
+
+	int32_t x{ start.x };
+	int32_t y{ start.y };
+	while (true) {
+		framebuffer.setPixel(x, y, packed);
+		if (x == end.x && y == end.y) {
+			break;
+		}
+		int32_t doubled{ 2 * error };
+		if (doubled >= dy) {
+			error += dy;
+			x += stepX;
+		}
+		if (doubled <= dx) {
+			error += dx;
+			y += stepY;
+		}
+	}
+}
+
+LineBatch::LineBatch(sf::RenderWindow& window)
+	: m_window{ window }, m_lines{ sf::PrimitiveType::Lines } {
+}
+
+void LineBatch::append(sf::Vector2i start, sf::Vector2i end, sf::Color color) {
+	m_lines.append(sf::Vertex{ sf::Vector2f{ start }, color });
+	m_lines.append(sf::Vertex{ sf::Vector2f{ end }, color });
+}
+
+void LineBatch::flush() {
+	if (m_lines.getVertexCount() > 0) {
+		m_window.draw(m_lines);
+		m_lines.clear();
+	}
+}
+
+void drawLine(LineBatch& batch, sf::Vector2i start, sf::Vector2i end, sf::Color color) {
+	batch.append(start, end, color);
+}
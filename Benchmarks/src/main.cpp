@@ -0,0 +1,382 @@
+/**
+* Times each stage of the software pipeline on its own, on the cube from LocalSpace and the
+* Stanford Bunny at several scales, without opening a window. Prints a summary table and writes
+* every measurement to a JSON file, so runs on different commits can be compared.
+*/
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numbers>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <glm/ext.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "Mesh.h"
+#include "edges.h"
+#include "stages.h"
+#include "triangles.h"
+#include "vertex_transform.h"
+
+const size_t VERTICES_PER_FACE{ 3 };
+
+// Reads the vertices and faces of the first mesh in an asset file supported by Assimp.
+void assimpLoad(const std::string& path, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces) {
+	Assimp::Importer importer{};
+	const aiScene* scene{ importer.ReadFile(path, aiProcessPreset_TargetRealtime_MaxQuality) };
+	if (nullptr == scene) {
+		std::cout << "ASSIMP ERROR" << importer.GetErrorString() << std::endl;
+		exit(1);
+	}
+	const aiMesh* mesh{ scene->mMeshes[0] };
+	for (size_t i{ 0 }; i < mesh->mNumVertices; ++i) {
+		vertices.push_back({ mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z });
+	}
+	faces.reserve(mesh->mNumFaces * VERTICES_PER_FACE);
+	for (size_t i{ 0 }; i < mesh->mNumFaces; ++i) {
+		faces.push_back(mesh->mFaces[i].mIndices[0]);
+		faces.push_back(mesh->mFaces[i].mIndices[1]);
+		faces.push_back(mesh->mFaces[i].mIndices[2]);
+	}
+}
+
+// A mesh to benchmark, and the pose the demos draw it with. Each scale multiplies the mesh's
+// usual scale, which changes how many pixels its lines cover but not how many vertices it has.
+struct BenchmarkMesh {
+	std::string name;
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> faces;
+	std::vector<uint32_t> edges;
+	sf::Vector3f position;
+	sf::Vector3f orientation;
+	float scale;
+};
+
+const float SCALES[]{ 0.25f, 1.0f, 2.0f };
+
+struct Options {
+	// --repetitions N: how many timed repetitions of each benchmark, after one warm-up.
+	size_t repetitions{ 10 };
+	// --min-time MS: each repetition repeats the stage until at least this much time has passed,
+	// so that even the cube's 8 vertices take long enough to time accurately.
+	double minMilliseconds{ 20.0 };
+	// --model PATH: the mesh loaded with Assimp.
+	std::string modelPath{ "models/bunny.obj" };
+	// --output FILE: where the JSON results are written.
+	std::string outputPath{ "benchmarks.json" };
+	// --label TEXT: copied into the JSON, to identify the run (a commit hash, for example).
+	std::string label;
+};
+
+// Prints a problem with the command line and the usage line, then exits.
+void failOptions(const char* program, std::string_view problem) {
+	std::cout << problem << std::endl;
+	std::cout << "Usage: " << program << " [--repetitions N] [--min-time MS] [--model PATH] [--output FILE] [--label TEXT]" << std::endl;
+	exit(1);
+}
+
+// Parses a whole string as a number, with no leading or trailing characters.
+template <typename Number>
+bool parseNumber(std::string_view text, Number& value) {
+	auto [end, error] { std::from_chars(text.data(), text.data() + text.size(), value) };
+	return error == std::errc{} && end == text.data() + text.size();
+}
+
+Options parseOptions(int argc, char* argv[]) {
+	Options options{};
+	for (int i{ 1 }; i < argc; ++i) {
+		std::string_view arg{ argv[i] };
+		if (arg == "--repetitions" && i + 1 < argc) {
+			std::string_view value{ argv[++i] };
+			if (!parseNumber(value, options.repetitions) || options.repetitions == 0) {
+				failOptions(argv[0], "--repetitions needs a positive number, not " + std::string{ value });
+			}
+		}
+		else if (arg == "--min-time" && i + 1 < argc) {
+			std::string_view value{ argv[++i] };
+			if (!parseNumber(value, options.minMilliseconds) || !std::isfinite(options.minMilliseconds)
+				|| options.minMilliseconds < 0) {
+				failOptions(argv[0], "--min-time needs a number of milliseconds, 0 or more, not " + std::string{ value });
+			}
+		}
+		else if (arg == "--model" && i + 1 < argc) {
+			options.modelPath = argv[++i];
+		}
+		else if (arg == "--output" && i + 1 < argc) {
+			options.outputPath = argv[++i];
+		}
+		else if (arg == "--label" && i + 1 < argc) {
+			options.label = argv[++i];
+		}
+		else {
+			failOptions(argv[0], "Unknown option " + std::string{ arg });
+		}
+	}
+	return options;
+}
+
+// The measurements of one stage, on one mesh at one scale.
+struct Result {
+	std::string stage;
+	std::string mesh;
+	float scale;
+	// What the stage processes: "vertex", "edge", or "triangle".
+	std::string unit;
+	// How many of them one pass over the mesh processes.
+	size_t items;
+	// Nanoseconds per item, one entry per repetition.
+	std::vector<double> nanoseconds;
+};
+
+// Stages write their results somewhere the compiler cannot prove is unused, so it cannot skip the
+// work being timed.
+volatile double g_sink{ 0.0 };
+
+// Times pass(), which processes `items` items, and returns nanoseconds per item for each
+// repetition. The first, untimed repetition warms the caches and measures how many passes fill
+// the minimum repetition time.
+std::vector<double> measure(const Options& options, size_t items, const std::function<void()>& pass) {
+	using Clock = std::chrono::steady_clock;
+	auto start{ Clock::now() };
+	size_t passes{ 0 };
+	double minNanoseconds{ options.minMilliseconds * 1e6 };
+	do {
+		pass();
+		++passes;
+	} while (std::chrono::duration<double, std::nano>(Clock::now() - start).count() < minNanoseconds);
+
+	std::vector<double> nanoseconds;
+	for (size_t repetition{ 0 }; repetition < options.repetitions; ++repetition) {
+		start = Clock::now();
+		for (size_t i{ 0 }; i < passes; ++i) {
+			pass();
+		}
+		double elapsed{ std::chrono::duration<double, std::nano>(Clock::now() - start).count() };
+		nanoseconds.push_back(elapsed / (static_cast<double>(passes) * items));
+	}
+	return nanoseconds;
+}
+
+// Summary statistics of one result's repetitions.
+struct Summary {
+	double min;
+	double median;
+	double mean;
+	double stddev;
+	double max;
+};
+
+Summary summarize(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	double sum{ 0.0 };
+	for (double value : values) {
+		sum += value;
+	}
+	double mean{ sum / values.size() };
+	double squares{ 0.0 };
+	for (double value : values) {
+		squares += (value - mean) * (value - mean);
+	}
+	double stddev{ values.size() > 1 ? std::sqrt(squares / (values.size() - 1)) : 0.0 };
+	size_t middle{ values.size() / 2 };
+	double median{ values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2 };
+	return Summary{ values.front(), median, mean, stddev, values.back() };
+}
+
+// Runs every stage on one mesh at one scale. Each stage reads the previous stage's output,
+// computed once up front, so it is timed with the same inputs it would see in drawMesh.
+void benchmarkMesh(const Options& options, const BenchmarkMesh& mesh, float scale, Framebuffer& framebuffer,
+	const Frustum& frustum, std::vector<Result>& results) {
+	sf::Vector3f objectScale{ mesh.scale * scale, mesh.scale * scale, mesh.scale * scale };
+	sf::Vector3f cameraPosition{ 0, 0, 0 };
+	sf::Vector3f cameraOrientation{ 0, 0, 0 };
+	const sf::View& viewport{ framebuffer.getView() };
+	size_t vertexCount{ mesh.vertices.size() };
+
+	std::vector<Vertex3D> world(vertexCount);
+	std::vector<Vertex3D> view(vertexCount);
+	std::vector<Vertex3D> clip(vertexCount);
+	std::vector<sf::Vector2i> screen(vertexCount);
+	for (size_t i{ 0 }; i < vertexCount; ++i) {
+		world[i] = localToWorld(mesh.position, mesh.orientation, objectScale, mesh.vertices[i]);
+		view[i] = worldToView(cameraPosition, cameraOrientation, world[i]);
+		clip[i] = viewToClip(frustum, view[i]);
+		screen[i] = clipToScreen(viewport, clip[i]);
+	}
+
+	auto add{ [&](const std::string& stage, const std::string& unit, size_t items, const std::function<void()>& pass) {
+		results.push_back(Result{ stage, mesh.name, scale, unit, items, measure(options, items, pass) });
+	} };
+
+	std::vector<Vertex3D> output(vertexCount);
+	add("localToWorld", "vertex", vertexCount, [&] {
+		for (size_t i{ 0 }; i < vertexCount; ++i) {
+			output[i] = localToWorld(mesh.position, mesh.orientation, objectScale, mesh.vertices[i]);
+		}
+		g_sink = g_sink + output[0].x;
+	});
+	add("worldToView", "vertex", vertexCount, [&] {
+		for (size_t i{ 0 }; i < vertexCount; ++i) {
+			output[i] = worldToView(cameraPosition, cameraOrientation, world[i]);
+		}
+		g_sink = g_sink + output[0].x;
+	});
+	add("viewToClip", "vertex", vertexCount, [&] {
+		for (size_t i{ 0 }; i < vertexCount; ++i) {
+			output[i] = viewToClip(frustum, view[i]);
+		}
+		g_sink = g_sink + output[0].x;
+	});
+	std::vector<sf::Vector2i> screenOutput(vertexCount);
+	add("clipToScreen", "vertex", vertexCount, [&] {
+		for (size_t i{ 0 }; i < vertexCount; ++i) {
+			screenOutput[i] = clipToScreen(viewport, clip[i]);
+		}
+		g_sink = g_sink + screenOutput[0].x;
+	});
+
+	// The Matrices path does all four stages in one pass, with each SIMD level this CPU has.
+	// Built to match localToWorld: yaw, pitch, and roll, then scale, then translate.
+	glm::mat4 model{ glm::translate(glm::mat4(1), glm::vec3(mesh.position.x, mesh.position.y, mesh.position.z)) };
+	model = glm::scale(model, glm::vec3(objectScale.x, objectScale.y, objectScale.z));
+	model = glm::rotate(model, mesh.orientation.z, glm::vec3(0, 0, 1));
+	model = glm::rotate(model, mesh.orientation.x, glm::vec3(1, 0, 0));
+	model = glm::rotate(model, mesh.orientation.y, glm::vec3(0, 1, 0));
+	glm::mat4 projection{ glm::frustum(frustum.left, frustum.right, frustum.bottom, frustum.top, frustum.near, frustum.far) };
+	glm::mat4 mvp{ projection * model };
+	PositionsSoA positions{ toStructureOfArrays(mesh.vertices) };
+	ScreenPositionsSoA screenPositions{};
+	for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2 }) {
+		if (level > detectSimdLevel()) {
+			break;
+		}
+		add(std::string{ "mvpTransform/" } + simdLevelName(level), "vertex", vertexCount, [&] {
+			transformToScreen(glm::value_ptr(mvp), positions, viewport.getSize().x, viewport.getSize().y, screenPositions, level);
+			g_sink = g_sink + screenPositions.x[0];
+		});
+	}
+
+	sf::Color color{ sf::Color::White };
+	add("drawLine", "edge", mesh.edges.size() / 2, [&] {
+		for (size_t i{ 0 }; i < mesh.edges.size(); i = i + 2) {
+			drawLine(framebuffer, screen[mesh.edges[i]], screen[mesh.edges[i + 1]], color);
+		}
+	});
+	add("drawTriangle", "triangle", mesh.faces.size() / VERTICES_PER_FACE, [&] {
+		for (size_t i{ 0 }; i < mesh.faces.size(); i = i + VERTICES_PER_FACE) {
+			drawTriangle(framebuffer, screen[mesh.faces[i]], screen[mesh.faces[i + 1]], screen[mesh.faces[i + 2]], color);
+		}
+	});
+}
+
+// Writes a string as a JSON string literal.
+void writeJsonString(std::ostream& out, std::string_view text) {
+	out << '"';
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20) {
+			out << ' ';
+		}
+		else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+void writeJson(std::ostream& out, const Options& options, const std::vector<Result>& results) {
+	out << "{\n  \"label\": ";
+	writeJsonString(out, options.label);
+	out << ",\n  \"simd\": ";
+	writeJsonString(out, simdLevelName(detectSimdLevel()));
+	out << ",\n  \"repetitions\": " << options.repetitions << ",\n  \"results\": [";
+	for (size_t i{ 0 }; i < results.size(); ++i) {
+		const Result& result{ results[i] };
+		Summary summary{ summarize(result.nanoseconds) };
+		out << (i == 0 ? "\n" : ",\n") << "    { \"stage\": ";
+		writeJsonString(out, result.stage);
+		out << ", \"mesh\": ";
+		writeJsonString(out, result.mesh);
+		out << ", \"scale\": " << result.scale << ", \"unit\": ";
+		writeJsonString(out, result.unit);
+		out << ", \"items\": " << result.items
+			<< ", \"ns_per_item\": { \"min\": " << summary.min << ", \"median\": " << summary.median
+			<< ", \"mean\": " << summary.mean << ", \"stddev\": " << summary.stddev << ", \"max\": " << summary.max
+			<< " }, \"samples\": [";
+		for (size_t j{ 0 }; j < result.nanoseconds.size(); ++j) {
+			out << (j == 0 ? "" : ", ") << result.nanoseconds[j];
+		}
+		out << "] }";
+	}
+	out << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+	Options options{ parseOptions(argc, argv) };
+
+	// The same 1080p screen and frustum as the demos on a typical monitor.
+	Framebuffer framebuffer{ sf::Vector2u{ 1920, 1080 } };
+	float fovy{ 60.0f };
+	float ratio{ 1920.0f / 1080.0f };
+	float near{ 0.1f };
+	float far{ 100.0f };
+	float t{ static_cast<float>(near * std::tan((fovy * std::numbers::pi_v<float> / 180.0f) / 2)) };
+	float r{ t * ratio };
+	Frustum frustum{ near, far, -r, r, -t, t };
+
+	std::vector<BenchmarkMesh> meshes;
+	BenchmarkMesh cube{ "cube", {}, {}, {}, sf::Vector3f{ 0, 0, -3 }, sf::Vector3f{ std::numbers::pi_v<float> / 12, std::numbers::pi_v<float> / 8, 0 }, 1.0f };
+	cube.vertices = {
+		{ 0.5, 0.5, -0.5 }, { -0.5, 0.5, -0.5 }, { -0.5, -0.5, -0.5 }, { 0.5, -0.5, -0.5 },
+		{ 0.5, 0.5, 0.5 }, { -0.5, 0.5, 0.5 }, { -0.5, -0.5, 0.5 }, { 0.5, -0.5, 0.5 }
+	};
+	cube.faces = {
+		0, 1, 2, 0, 2, 3, 4, 0, 3, 4, 3, 7, 5, 4, 7, 5, 7, 6,
+		1, 5, 6, 1, 6, 2, 4, 5, 1, 4, 1, 0, 2, 6, 7, 2, 7, 3
+	};
+	meshes.push_back(cube);
+	BenchmarkMesh bunny{ "bunny", {}, {}, {}, sf::Vector3f{ 0, -1, -2.5 }, sf::Vector3f{ 0, 0, 0 }, 9.0f };
+	assimpLoad(options.modelPath, bunny.vertices, bunny.faces);
+	meshes.push_back(bunny);
+	for (BenchmarkMesh& mesh : meshes) {
+		mesh.edges = extractEdges(mesh.faces);
+	}
+
+	std::vector<Result> results;
+	for (const BenchmarkMesh& mesh : meshes) {
+		for (float scale : SCALES) {
+			benchmarkMesh(options, mesh, scale, framebuffer, frustum, results);
+		}
+	}
+
+	std::cout << "stage                  mesh    scale  ns/item (median)  stddev" << std::endl;
+	for (const Result& result : results) {
+		Summary summary{ summarize(result.nanoseconds) };
+		std::string stage{ result.stage };
+		stage.resize(std::max<size_t>(stage.size(), 22), ' ');
+		std::string mesh{ result.mesh };
+		mesh.resize(std::max<size_t>(mesh.size(), 7), ' ');
+		std::cout << stage << " " << mesh << " " << result.scale << "\t" << summary.median
+			<< " per " << result.unit << "\t" << summary.stddev << std::endl;
+	}
+
+	std::ofstream file{ options.outputPath };
+	writeJson(file, options, results);
+	if (!file) {
+		std::cout << "Could not write " << options.outputPath << std::endl;
+		return 1;
+	}
+	std::cout << "Wrote " << results.size() << " results to " << options.outputPath << std::endl;
+	return 0;
+}
@@ -0,0 +1,23 @@
+#include "triangles.h"
+#include "lines.h"
+
+void drawTriangle(sf::RenderWindow& window, sf::Vector2i a, sf::Vector2i b,
+	sf::Vector2i c, sf::Color color) {
+	drawLine(window, a, b, color);
+	drawLine(window, a, c, color);
+	drawLine(window, b, c, color);
+}
+
+void drawTriangle(Framebuffer& framebuffer, sf::Vector2i a, sf::Vector2i b,
+	sf::Vector2i c, sf::Color color) {
+	drawLine(framebuffer, a, b, color);
+	drawLine(framebuffer, a, c, color);
+	drawLine(framebuffer, b, c, color);
+}
+
+void drawTriangle(LineBatch& batch, sf::Vector2i a, sf::Vector2i b,
+	sf::Vector2i c, sf::Color color) {
+	drawLine(batch, a, b, color);
+	drawLine(batch, a, c, color);
+	drawLine(batch, b, c, color);
+}
@@ -0,0 +1,48 @@
+#include "framebuffer.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+Framebuffer::Framebuffer(sf::Vector2u size)
+	: m_size{ size },
+	m_pixels(static_cast<size_t>(size.x) * size.y),
+	m_view{ sf::FloatRect{ { 0.0f, 0.0f }, sf::Vector2f{ size } } } {
+}
+
+void Framebuffer::clear(sf::Color color) {
+	std::fill(m_pixels.begin(), m_pixels.end(), pack(color));
+}
+
+void Framebuffer::present(sf::RenderWindow& window) {
+	// The texture is created on first use, so a framebuffer can be filled without an OpenGL context.
+	if (m_texture.getSize() != m_size && !m_texture.resize(m_size)) {
+		std::cout << "Could not create a " << m_size.x << "x" << m_size.y << " framebuffer texture" << std::endl;
+		return;
+	}
+	m_texture.update(reinterpret_cast<const std::uint8_t*>(m_pixels.data()));
+
+	sf::Sprite sprite{ m_texture };
+	window.draw(sprite);
+}
+
+bool Framebuffer::saveToFile(const std::string& path) const {
+	if (path.size() < 4 || path.compare(path.size() - 4, 4, ".ppm") != 0) {
+		sf::Image image{ m_size, reinterpret_cast<const std::uint8_t*>(m_pixels.data()) };
+		return image.saveToFile(path);
+	}
+
+	// PPM is a short text header followed by the raw RGB bytes of each pixel, row by row.
+	std::ofstream file{ path, std::ios::binary };
+	file << "P6\n" << m_size.x << " " << m_size.y << "\n255\n";
+	std::vector<char> row(static_cast<size_t>(m_size.x) * 3);
+	for (size_t y{ 0 }; y < m_size.y; ++y) {
+		for (size_t x{ 0 }; x < m_size.x; ++x) {
+			std::uint32_t pixel{ m_pixels[y * m_size.x + x] };
+			row[x * 3] = static_cast<char>(pixel & 0xff);
+			row[x * 3 + 1] = static_cast<char>((pixel >> 8) & 0xff);
+			row[x * 3 + 2] = static_cast<char>((pixel >> 16) & 0xff);
+		}
+		file.write(row.data(), static_cast<std::streamsize>(row.size()));
+	}
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+
+// Which way the corners of a mesh's front faces go around when seen from in front, that is,
+// from outside a closed mesh. Meshes exported for OpenGL, like most OBJ files, are usually
+// counterclockwise; hand-written face lists can go either way.
+enum class FrontFace {
+	CounterClockwise,
+	Clockwise
+};
+
+// Twice the signed area of a triangle in screen coordinates. Screen y points down, so this is
+// positive when the corners appear clockwise on screen and negative when counterclockwise.
+inline int64_t screenSignedArea(sf::Vector2i a, sf::Vector2i b, sf::Vector2i c) {
+	return (static_cast<int64_t>(b.x) - a.x) * (static_cast<int64_t>(c.y) - a.y)
+		- (static_cast<int64_t>(b.y) - a.y) * (static_cast<int64_t>(c.x) - a.x);
+}
+
+// True if a triangle that has been projected to the screen faces away from the camera. A front
+// face keeps its winding when projected, and a back face, seen from behind, appears reversed.
+// Edge-on triangles have no area and are treated as back faces.
+inline bool isBackFacing(sf::Vector2i a, sf::Vector2i b, sf::Vector2i c, FrontFace frontFace) {
+	int64_t area{ screenSignedArea(a, b, c) };
+	return frontFace == FrontFace::Clockwise ? area <= 0 : area >= 0;
+}
+
+// Settings for the optional back-face culling stage, and its counts since the last profiler
+// report. In a closed mesh every back face is hidden behind front faces, so culling them
+// removes about half the triangles before they are drawn.
+struct BackFaceCulling {
+	bool enabled{ false };
+	FrontFace frontFace{ FrontFace::CounterClockwise };
+	// Triangles that reached the stage, and how many of them it dropped.
+	size_t submitted{ 0 };
+	size_t culled{ 0 };
+};
@@ -1,11 +1,26 @@
 ﻿#include <SFML/Graphics.hpp>
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <span>
 #include <vector>
+#include <string_view>
+#include <type_traits>
 #include <numbers>
+#include <optional>
 
 #include "triangles.h"
+#include "edges.h"
+#include "culling.h"
+#include "headless.h"
+#include "profiler.h"
+#include "trace.h"
 
-#define LOG_FPS
 struct Vertex3D {
 	float x;
 	float y;
@@ -79,19 +94,244 @@ Vertex3D worldToView(const sf::Vector3f& cameraPosition, const sf::Vector3f& cam
 	float pitchZ{ rollY * std::sin(cOrientation.x) + rollZ * std::cos(cOrientation.x) };
 
 	float yawX{ pitchX * std::cos(cOrientation.y) + pitchZ * std::sin(cOrientation.y) };
-	float yawY{ vertex.y };
+	float yawY{ pitchY };
 	float yawZ{ -pitchX * std::sin(cOrientation.y) + pitchZ * std::cos(cOrientation.y) };
 
 	return Vertex3D{ yawX, yawY, yawZ };
 }
 
+// An affine transform stored as a 3x4 matrix: a 3x3 linear part in the first three columns and a
+// translation in the last. Compiling an object's position, orientation, and scale (or the
+// camera's pose) into one of these once per draw call replaces the dozen sines and cosines that
+// localToWorld and worldToView evaluate for every vertex.
+struct AffineTransform {
+	float m[3][4];
+};
+
+// Returns the transform that applies `first`, then `second`.
+AffineTransform compose(const AffineTransform& second, const AffineTransform& first) {
+	AffineTransform result{};
+	for (int row{ 0 }; row < 3; ++row) {
+		for (int col{ 0 }; col < 4; ++col) {
+			result.m[row][col] = second.m[row][0] * first.m[0][col]
+				+ second.m[row][1] * first.m[1][col]
+				+ second.m[row][2] * first.m[2][col];
+		}
+		result.m[row][3] += second.m[row][3];
+	}
+	return result;
+}
+
+// Rotations around a single axis, matching the yaw, pitch, and roll steps of localToWorld.
+AffineTransform yawTransform(float angle) {
+	float c{ std::cos(angle) };
+	float s{ std::sin(angle) };
+	return AffineTransform{ {
+		{ c, 0, s, 0 },
+		{ 0, 1, 0, 0 },
+		{ -s, 0, c, 0 }
+	} };
+}
+
+AffineTransform pitchTransform(float angle) {
+	float c{ std::cos(angle) };
+	float s{ std::sin(angle) };
+	return AffineTransform{ {
+		{ 1, 0, 0, 0 },
+		{ 0, c, -s, 0 },
+		{ 0, s, c, 0 }
+	} };
+}
+
+AffineTransform rollTransform(float angle) {
+	float c{ std::cos(angle) };
+	float s{ std::sin(angle) };
+	return AffineTransform{ {
+		{ c, -s, 0, 0 },
+		{ s, c, 0, 0 },
+		{ 0, 0, 1, 0 }
+	} };
+}
+
+// The same transformation as localToWorld, compiled once for the whole object.
+AffineTransform localToWorldTransform(
+	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale) {
+	AffineTransform transform{ compose(rollTransform(orientation.z),
+		compose(pitchTransform(orientation.x), yawTransform(orientation.y))) };
+
+	// Scaling after rotating multiplies each row by its axis' scale; translating fills in the
+	// last column.
+	float axisScale[3]{ scale.x, scale.y, scale.z };
+	for (int row{ 0 }; row < 3; ++row) {
+		for (int col{ 0 }; col < 3; ++col) {
+			transform.m[row][col] *= axisScale[row];
+		}
+	}
+	transform.m[0][3] = position.x;
+	transform.m[1][3] = position.y;
+	transform.m[2][3] = position.z;
+	return transform;
+}
+
+// The same transformation as worldToView, compiled once for the camera.
+AffineTransform worldToViewTransform(const sf::Vector3f& cameraPosition, const sf::Vector3f& cameraOrientation) {
+	AffineTransform translate{ {
+		{ 1, 0, 0, -cameraPosition.x },
+		{ 0, 1, 0, -cameraPosition.y },
+		{ 0, 0, 1, -cameraPosition.z }
+	} };
+	return compose(yawTransform(-cameraOrientation.y),
+		compose(pitchTransform(-cameraOrientation.x),
+			compose(rollTransform(-cameraOrientation.z), translate)));
+}
+
+// Applies an affine transform to a vertex: three multiply-add chains, which the compiler can emit
+// as fused multiply-add instructions.
+Vertex3D transformVertex(const AffineTransform& transform, const Vertex3D& vertex) {
+	const auto& m{ transform.m };
+	return Vertex3D{
+		m[0][0] * vertex.x + m[0][1] * vertex.y + m[0][2] * vertex.z + m[0][3],
+		m[1][0] * vertex.x + m[1][1] * vertex.y + m[1][2] * vertex.z + m[1][3],
+		m[2][0] * vertex.x + m[2][1] * vertex.y + m[2][2] * vertex.z + m[2][3]
+	};
+}
+
+// The compiled transforms perform the same arithmetic as the step-by-step functions, grouped
+// differently, so the two paths differ only by float rounding. We consider them to match when
+// each coordinate agrees to within TRANSFORM_TOLERANCE, relative to the coordinate's magnitude
+// (or absolutely, for coordinates smaller than 1).
+const float TRANSFORM_TOLERANCE{ 1e-4f };
+
+bool matchesWithinTolerance(const Vertex3D& actual, const Vertex3D& expected) {
+	auto close{ [](float a, float e) {
+		return std::abs(a - e) <= TRANSFORM_TOLERANCE * std::max(1.0f, std::abs(e));
+	} };
+	return close(actual.x, expected.x) && close(actual.y, expected.y) && close(actual.z, expected.z);
+}
+
+// Bounds of a mesh in its own local space, computed once when the mesh is loaded or built: an
+// axis-aligned box, and a sphere around the box's center that contains every vertex.
+struct MeshBounds {
+	Vertex3D min;
+	Vertex3D max;
+	Vertex3D center;
+	float radius;
+};
+
+MeshBounds computeBounds(const std::vector<Vertex3D>& vertices) {
+	if (vertices.empty()) {
+		return MeshBounds{};
+	}
+	MeshBounds bounds{ vertices[0], vertices[0], vertices[0], 0.0f };
+	for (const Vertex3D& vertex : vertices) {
+		bounds.min = Vertex3D{ std::min(bounds.min.x, vertex.x), std::min(bounds.min.y, vertex.y), std::min(bounds.min.z, vertex.z) };
+		bounds.max = Vertex3D{ std::max(bounds.max.x, vertex.x), std::max(bounds.max.y, vertex.y), std::max(bounds.max.z, vertex.z) };
+	}
+	bounds.center = Vertex3D{ (bounds.min.x + bounds.max.x) / 2, (bounds.min.y + bounds.max.y) / 2, (bounds.min.z + bounds.max.z) / 2 };
+	float radiusSquared{ 0 };
+	for (const Vertex3D& vertex : vertices) {
+		float dx{ vertex.x - bounds.center.x };
+		float dy{ vertex.y - bounds.center.y };
+		float dz{ vertex.z - bounds.center.z };
+		radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+	}
+	bounds.radius = std::sqrt(radiusSquared);
+	return bounds;
+}
+
+// A plane in view space. A point p is on the inner side when
+// normal.x * p.x + normal.y * p.y + normal.z * p.z + distance >= 0.
+struct Plane {
+	Vertex3D normal;
+	float distance;
+};
+
+Plane normalizedPlane(float x, float y, float z, float distance) {
+	float length{ std::sqrt(x * x + y * y + z * z) };
+	return Plane{ { x / length, y / length, z / length }, distance / length };
+}
+
+// The six planes enclosing a frustum, with normals pointing inward. The camera looks down the
+// negative z axis, and left, right, bottom, and top are measured on the near plane, so the side
+// planes all pass through the camera.
+std::array<Plane, 6> frustumPlanes(const Frustum& frustum) {
+	return std::array<Plane, 6>{
+		normalizedPlane(0, 0, -1, -frustum.near),
+		normalizedPlane(0, 0, 1, frustum.far),
+		normalizedPlane(frustum.near, 0, frustum.left, 0),
+		normalizedPlane(-frustum.near, 0, -frustum.right, 0),
+		normalizedPlane(0, frustum.near, frustum.bottom, 0),
+		normalizedPlane(0, -frustum.near, -frustum.top, 0)
+	};
+}
+
+// The object-level culling stage: the frustum's planes, and counts since the last profiler report.
+struct FrustumCulling {
+	std::array<Plane, 6> planes;
+	// Objects submitted to drawMesh, and how many of them were skipped.
+	size_t submitted{ 0 };
+	size_t culled{ 0 };
+};
+
+// True if an object with the given local bounds lies entirely outside one of the frustum's
+// planes once it is transformed to view space. `largestScale` is the largest of the object's
+// scale factors: rotating and moving it does not change the sphere's size, so that is how much
+// the sphere grows. The sphere is tested first because it is cheaper; objects that pass are
+// tested again with their box, which fits boxy meshes like our cube more tightly. Objects
+// crossing a corner of the frustum can pass both tests while still being outside, which only
+// costs drawing them.
+// This demo does not clip, so objects that reach past the near plane are skipped too: their
+// vertices at or behind the camera would be divided by a view z near or above 0, and land far off
+// the screen or mirrored across it.
+bool isOutsideFrustum(const std::array<Plane, 6>& planes, const AffineTransform& localToView,
+	float largestScale, const MeshBounds& bounds) {
+	const auto& m{ localToView.m };
+	Vertex3D center{ transformVertex(localToView, bounds.center) };
+	float radius{ bounds.radius * largestScale };
+	// Where the box's local x, y, and z axes point in view space, scaled along with it.
+	Vertex3D axes[3]{
+		{ m[0][0], m[1][0], m[2][0] },
+		{ m[0][1], m[1][1], m[2][1] },
+		{ m[0][2], m[1][2], m[2][2] }
+	};
+	float halfExtents[3]{ (bounds.max.x - bounds.min.x) / 2, (bounds.max.y - bounds.min.y) / 2, (bounds.max.z - bounds.min.z) / 2 };
+
+	for (size_t i{ 0 }; i < planes.size(); ++i) {
+		const Plane& plane{ planes[i] };
+		float centerDistance{ plane.normal.x * center.x + plane.normal.y * center.y + plane.normal.z * center.z + plane.distance };
+		if (centerDistance < -radius) {
+			return true;
+		}
+		// How far the transformed box reaches toward the plane from its center.
+		float boxReach{ 0 };
+		for (int axis{ 0 }; axis < 3; ++axis) {
+			boxReach += halfExtents[axis]
+				* std::abs(plane.normal.x * axes[axis].x + plane.normal.y * axes[axis].y + plane.normal.z * axes[axis].z);
+		}
+		if (centerDistance < -boxReach) {
+			return true;
+		}
+		// The near plane comes first. Both the sphere and the box bound how far the object reaches,
+		// so it is wholly behind the plane if its center is farther than either.
+		if (i == 0 && centerDistance < std::min(radius, boxReach)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 // Transform from view coordinates to clip coordinates.
 Vertex3D viewToClip(const Frustum& frustum, const Vertex3D& view) {
 	float xp{ view.x * -frustum.near / view.z };
 	float yp{ view.y * -frustum.near / view.z };
 	float xClip{ xp / frustum.right };
 	float yClip{ yp / frustum.top };
-	return Vertex3D{ xClip, yClip, 0.0f };
+	// Depth goes from -1 at the near plane to 1 at the far plane, the same as OpenGL's
+	// perspective projection after the divide by w. Our wireframes don't use it yet, but a
+	// depth buffer would.
+	float zClip{ (frustum.far + frustum.near) / (frustum.far - frustum.near)
+		+ 2 * frustum.far * frustum.near / ((frustum.far - frustum.near) * view.z) };
+	return Vertex3D{ xClip, yClip, zClip };
 }
 
 // Linear interpolate from clip coordinates to screen coordinates.
@@ -101,48 +341,409 @@ sf::Vector2i clipToScreen(const sf::View& viewport, const Vertex3D& clip) {
 	return sf::Vector2i{ xs, ys };
 }
 
-void drawMesh(sf::RenderWindow& window, const Frustum& frustum,
+// Screen-space positions for every vertex of the mesh being drawn. drawMesh fills it once per
+// call, so vertices shared by several faces are only transformed once; drawInstances fills it
+// with a batch of instances at a time. It is kept between calls so the buffers do not need to be
+// reallocated every frame.
+struct VertexCache {
+	std::vector<sf::Vector2i> screen;
+	// The instances drawInstances found inside the frustum, and their local-to-view transforms.
+	std::vector<uint32_t> visibleInstances;
+	std::vector<AffineTransform> visibleTransforms;
+	// Running total since the last profiler report.
+	size_t verticesTransformed{ 0 };
+};
+
+// Transforms every vertex of a mesh to screen coordinates, storing them in the cache.
+void transformVertices(const sf::View& viewport, const Frustum& frustum,
 	const sf::Vector3f& cameraPosition, const sf::Vector3f& cameraOrientation,
 	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale,
-	const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces, sf::Color color) {
-	// Loop through the list of face indexes, 3 at a time.
-	// Pull each vertex out of the vertices list.
-	// Transform them from clip coordinates to screen coordinates.
-	// Draw a triangle connecting them.
+	const std::vector<Vertex3D>& vertices, VertexCache& cache) {
+	PROFILE_STAGE(ProfileStage::Transform);
+	TRACE_SPAN("transform");
+	// Compile the object's and the camera's transforms once; each vertex then only costs one
+	// matrix multiply on its way to view space.
+	AffineTransform localToView{ compose(worldToViewTransform(cameraPosition, cameraOrientation),
+		localToWorldTransform(position, orientation, scale)) };
+
+	cache.screen.resize(vertices.size());
+	for (size_t i{ 0 }; i < vertices.size(); ++i) {
+		auto view{ transformVertex(localToView, vertices[i]) };
+		// Debug builds check the fast path against the step-by-step functions.
+		assert(matchesWithinTolerance(view, worldToView(cameraPosition, cameraOrientation,
+			localToWorld(position, orientation, scale, vertices[i]))));
+		auto clip{ viewToClip(frustum, view) };
+		cache.screen[i] = clipToScreen(viewport, clip);
+	}
+	cache.verticesTransformed += vertices.size();
+}
+
+// How drawMesh hands its lines to SFML. Chosen on the command line, so the paths can be
+// benchmarked against each other with the profiler.
+enum class SubmissionMode {
+	Immediate,  // --immediate: one window.draw call per line.
+	Batched,    // --batched: one window.draw call per drawMesh, from a retained vertex array.
+	Framebuffer // --framebuffer (default): rasterize into our framebuffer, present once per frame.
+};
+
+struct Options {
+	SubmissionMode submission{ SubmissionMode::Framebuffer };
+	// --edges: draw wireframes from each mesh's unique edge list instead of its faces.
+	bool uniqueEdges{ false };
+	// --cull: skip triangles facing away from the camera.
+	bool cull{ false };
+	// --front-face cw|ccw: the winding of front faces. Our cube's faces are listed clockwise.
+	FrontFace frontFace{ FrontFace::Clockwise };
+	// --cubes N: add N more cubes scattered all around the camera, most of them out of view.
+	size_t scatteredCubes{ 0 };
+	// --benchmark-instances: time drawing up to 100,000 cubes one by one and instanced, then exit.
+	bool benchmarkInstances{ false };
+	// --headless WxH, --frames N, --output FILE: render into the framebuffer without a window.
+	HeadlessOptions headless{};
+	// --trace FILE, --trace-frames N: record a timeline of the first frames.
+	TraceOptions trace{};
+};
+
+// The most cubes --cubes adds: far more than can be drawn at an interactive frame rate, but few
+// enough that a typo cannot ask for more memory than the machine has.
+const size_t MAX_SCATTERED_CUBES{ 10'000'000 };
+
+Options parseOptions(int argc, char* argv[]) {
+	Options options{};
+	for (int i{ 1 }; i < argc; ++i) {
+		std::string_view arg{ argv[i] };
+		if (arg == "--immediate") {
+			options.submission = SubmissionMode::Immediate;
+		}
+		else if (arg == "--batched") {
+			options.submission = SubmissionMode::Batched;
+		}
+		else if (arg == "--framebuffer") {
+			options.submission = SubmissionMode::Framebuffer;
+		}
+		else if (arg == "--edges") {
+			options.uniqueEdges = true;
+		}
+		else if (arg == "--cull") {
+			options.cull = true;
+		}
+		else if (arg == "--front-face" && i + 1 < argc && std::string_view{ argv[i + 1] } == "cw") {
+			options.frontFace = FrontFace::Clockwise;
+			++i;
+		}
+		else if (arg == "--front-face" && i + 1 < argc && std::string_view{ argv[i + 1] } == "ccw") {
+			options.frontFace = FrontFace::CounterClockwise;
+			++i;
+		}
+		else if (arg == "--cubes" && i + 1 < argc) {
+			std::string_view value{ argv[++i] };
+			auto [end, error] { std::from_chars(value.data(), value.data() + value.size(), options.scatteredCubes) };
+			if (error != std::errc{} || end != value.data() + value.size() || options.scatteredCubes > MAX_SCATTERED_CUBES) {
+				std::cout << "--cubes needs a number from 0 to " << MAX_SCATTERED_CUBES << ", not " << value << std::endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--benchmark-instances") {
+			options.benchmarkInstances = true;
+		}
+		else if (parseHeadlessOption(argc, argv, i, options.headless)) {
+			continue;
+		}
+		else if (parseTraceOption(argc, argv, i, options.trace)) {
+			continue;
+		}
+		else {
+			std::cout << "Unknown option " << arg << std::endl;
+			std::cout << "Usage: " << argv[0] << " [--immediate | --batched | --framebuffer] [--edges | --cull [--front-face cw|ccw]]"
+				<< " [--cubes N] [--benchmark-instances] " << HEADLESS_USAGE << " " << TRACE_USAGE << std::endl;
+			exit(1);
+		}
+	}
+	if (options.cull && options.uniqueEdges) {
+		// An edge is shared by a front face and a back face on the silhouette, so there is no
+		// way to cull an edge list.
+		std::cout << "--cull cannot be used with --edges" << std::endl;
+		exit(1);
+	}
+	if (options.headless.enabled && options.submission != SubmissionMode::Framebuffer) {
+		// The other modes draw through the window.
+		std::cout << "--headless can only be used with --framebuffer" << std::endl;
+		exit(1);
+	}
+	if (options.headless.frameOptionsGiven && !options.headless.enabled) {
+		std::cout << "--frames and --output can only be used with --headless" << std::endl;
+		exit(1);
+	}
+	return options;
+}
+
+// Counts an object submitted for drawing, and returns true if it is entirely outside the view,
+// so the caller can skip it before transforming a single vertex.
+bool isCulled(FrustumCulling& frustumCulling, const sf::Vector3f& cameraPosition, const sf::Vector3f& cameraOrientation,
+	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale, const MeshBounds& bounds) {
+	PROFILE_STAGE(ProfileStage::Clip);
+	TRACE_SPAN("frustum cull");
+	++frustumCulling.submitted;
+	AffineTransform localToView{ compose(worldToViewTransform(cameraPosition, cameraOrientation),
+		localToWorldTransform(position, orientation, scale)) };
+	float largestScale{ std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z) }) };
+	if (isOutsideFrustum(frustumCulling.planes, localToView, largestScale, bounds)) {
+		++frustumCulling.culled;
+		return true;
+	}
+	return false;
+}
+
+// An object placed in the world: a pose and a color for one of our meshes.
+struct SceneObject {
+	sf::Vector3f position;
+	sf::Vector3f orientation;
+	sf::Vector3f scale;
+	sf::Color color;
+};
+
+// Places `count` objects at random in a shell 4 to 30 units around the origin, in every
+// direction, so that at any time most of them are outside the frustum. The same count always
+// gives the same scene.
+std::vector<SceneObject> scatterObjects(size_t count) {
+	TRACE_SPAN("scatterObjects");
+	std::mt19937 random{ 449 };
+	std::uniform_real_distribution<float> unit{ -1.0f, 1.0f };
+	std::uniform_real_distribution<float> distance{ 4.0f, 30.0f };
+	std::uniform_real_distribution<float> angle{ 0.0f, 2 * std::numbers::pi_v<float> };
+	const sf::Color colors[]{ sf::Color::Red, sf::Color::Green, sf::Color::Blue, sf::Color::Yellow, sf::Color::Magenta, sf::Color::Cyan };
+
+	std::vector<SceneObject> objects;
+	objects.reserve(count);
+	while (objects.size() < count) {
+		// Pick a direction uniformly by rejecting points outside the unit ball.
+		sf::Vector3f direction{ unit(random), unit(random), unit(random) };
+		float length{ std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z) };
+		if (length > 1.0f || length < 0.01f) {
+			continue;
+		}
+		objects.push_back(SceneObject{
+			direction * (distance(random) / length),
+			sf::Vector3f{ angle(random), angle(random), angle(random) },
+			sf::Vector3f{ 1, 1, 1 },
+			colors[objects.size() % std::size(colors)]
+		});
+	}
+	return objects;
+}
+
+// RenderTarget is the sf::RenderWindow itself, a LineBatch that collects the lines for one
+// window.draw call, or a Framebuffer that we draw into. Index is the width of the mesh's face
+// indexes: uint16_t for meshes with at most 65536 vertices, like the cube, else uint32_t.
+template <typename RenderTarget, typename Index>
+void drawMesh(RenderTarget& target, VertexCache& cache, BackFaceCulling& culling, FrustumCulling& frustumCulling,
+	const Frustum& frustum, const sf::Vector3f& cameraPosition, const sf::Vector3f& cameraOrientation,
+	const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale,
+	const std::vector<Vertex3D>& vertices, const std::vector<Index>& faces, const MeshBounds& bounds, sf::Color color) {
+	TRACE_SPAN("drawMesh");
+	if (isCulled(frustumCulling, cameraPosition, cameraOrientation, position, orientation, scale, bounds)) {
+		return;
+	}
+	// Transform each vertex once, then loop through the list of face indexes, 3 at a time,
+	// looking up the screen coordinates of each corner and drawing a triangle connecting them.
+	transformVertices(target.getView(), frustum, cameraPosition, cameraOrientation,
+		position, orientation, scale, vertices, cache);
+	PROFILE_STAGE(ProfileStage::Raster);
+	TRACE_SPAN("raster");
 	for (size_t i{ 0 }; i < faces.size(); i = i + 3) {
-		auto& localA{ vertices[faces[i]] };
-		auto& localB{ vertices[faces[i + 1]] };
-		auto& localC{ vertices[faces[i + 2]] };
-
-		auto worldA{ localToWorld(position, orientation, scale, localA) };
-		auto worldB{ localToWorld(position, orientation, scale, localB) };
-		auto worldC{ localToWorld(position, orientation, scale, localC) };
-
-		auto viewA{ worldToView(cameraPosition, cameraOrientation, worldA) };
-		auto viewB{ worldToView(cameraPosition, cameraOrientation, worldB) };
-		auto viewC{ worldToView(cameraPosition, cameraOrientation, worldC) };
-
-		auto clipA{ viewToClip(frustum, viewA) };
-		auto clipB{ viewToClip(frustum, viewB) };
-		auto clipC{ viewToClip(frustum, viewC) };
-
-		auto& viewport{ window.getView() };
-		auto screenA{ clipToScreen(viewport, clipA) };
-		auto screenB{ clipToScreen(viewport, clipB) };
-		auto screenC{ clipToScreen(viewport, clipC) };
-
-		drawTriangle(window,
-			sf::Vector2i{ screenA.x, screenA.y },
-			sf::Vector2i{ screenB.x, screenB.y },
-			sf::Vector2i{ screenC.x, screenC.y },
-			color
-		);
+		const sf::Vector2i& a{ cache.screen[faces[i]] };
+		const sf::Vector2i& b{ cache.screen[faces[i + 1]] };
+		const sf::Vector2i& c{ cache.screen[faces[i + 2]] };
+		// Culling needs the corners on screen, so it runs after projection.
+		if (culling.enabled && isBackFacing(a, b, c, culling.frontFace)) {
+			++culling.culled;
+			continue;
+		}
+		drawTriangle(target, a, b, c, color);
+	}
+	culling.submitted += faces.size() / 3;
+
+	// Batched lines reach the window in a single draw call, once the whole mesh is collected.
+	if constexpr (std::is_same_v<RenderTarget, LineBatch>) {
+		target.flush();
 	}
 }
 
-int main() {
-	sf::RenderWindow window{ sf::VideoMode::getFullscreenModes().at(0), "SFML Demo" };
-	sf::Clock c;
+// A mesh that drawInstances can draw many copies of: everything about it that is the same for
+// every copy. Index is the width of its face and edge indexes (see drawMesh).
+template <typename Index>
+struct InstancedMesh {
+	std::vector<Vertex3D> vertices;
+	std::vector<Index> faces;
+	std::vector<Index> edges;
+	MeshBounds bounds;
+};
+
+// One copy of a mesh placed in the world. The pose is compiled into a transform when the instance
+// is placed, not every time it is drawn, and everything drawInstances reads about an instance
+// sits together, so walking an array of them reads memory front to back.
+struct Instance {
+	AffineTransform localToWorld;
+	// The largest of the instance's scale factors, for growing the mesh's bounding sphere.
+	float largestScale;
+	sf::Color color;
+};
+
+Instance makeInstance(const sf::Vector3f& position, const sf::Vector3f& orientation, const sf::Vector3f& scale, sf::Color color) {
+	return Instance{
+		localToWorldTransform(position, orientation, scale),
+		std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z) }),
+		color
+	};
+}
+
+// How many visible instances drawInstances transforms before drawing them. Their screen
+// positions stay in the cache between the two steps, and the transform and raster stages are
+// timed once per batch instead of once per instance.
+const size_t INSTANCE_BATCH_SIZE{ 256 };
+
+// Draws every instance of a mesh, the same as calling drawMesh once per instance, but sharing the
+// work those calls would repeat. With uniqueEdges, draws each instance's unique edges (see
+// extractEdges) instead of its faces, so edges shared by two faces are only drawn once. The camera's
+// transform is compiled once, the cache is sized once, the whole array is culled against the
+// frustum in one tight pass, and the survivors are transformed and drawn in batches. Batched
+// lines reach the window with one draw call for all the instances.
+template <typename RenderTarget, typename Index>
+void drawInstances(RenderTarget& target, VertexCache& cache, BackFaceCulling& culling, FrustumCulling& frustumCulling,
+	const Frustum& frustum, const sf::Vector3f& cameraPosition, const sf::Vector3f& cameraOrientation,
+	const InstancedMesh<Index>& mesh, std::span<const Instance> instances, bool uniqueEdges) {
+	TRACE_SPAN("drawInstances");
+	AffineTransform worldToView{ worldToViewTransform(cameraPosition, cameraOrientation) };
+	{
+		PROFILE_STAGE(ProfileStage::Clip);
+		TRACE_SPAN("frustum cull");
+		cache.visibleInstances.clear();
+		cache.visibleTransforms.clear();
+		for (size_t i{ 0 }; i < instances.size(); ++i) {
+			AffineTransform localToView{ compose(worldToView, instances[i].localToWorld) };
+			if (!isOutsideFrustum(frustumCulling.planes, localToView, instances[i].largestScale, mesh.bounds)) {
+				cache.visibleInstances.push_back(static_cast<uint32_t>(i));
+				cache.visibleTransforms.push_back(localToView);
+			}
+		}
+		frustumCulling.submitted += instances.size();
+		frustumCulling.culled += instances.size() - cache.visibleInstances.size();
+	}
+
+	const sf::View& viewport{ target.getView() };
+	size_t vertexCount{ mesh.vertices.size() };
+	cache.screen.resize(std::min(cache.visibleInstances.size(), INSTANCE_BATCH_SIZE) * vertexCount);
+	for (size_t first{ 0 }; first < cache.visibleInstances.size(); first += INSTANCE_BATCH_SIZE) {
+		size_t last{ std::min(first + INSTANCE_BATCH_SIZE, cache.visibleInstances.size()) };
+		{
+			PROFILE_STAGE(ProfileStage::Transform);
+			TRACE_SPAN("transform");
+			for (size_t i{ first }; i < last; ++i) {
+				const AffineTransform& localToView{ cache.visibleTransforms[i] };
+				sf::Vector2i* screen{ &cache.screen[(i - first) * vertexCount] };
+				for (size_t v{ 0 }; v < vertexCount; ++v) {
+					screen[v] = clipToScreen(viewport, viewToClip(frustum, transformVertex(localToView, mesh.vertices[v])));
+				}
+			}
+			cache.verticesTransformed += (last - first) * vertexCount;
+		}
+
+		PROFILE_STAGE(ProfileStage::Raster);
+		TRACE_SPAN("raster");
+		for (size_t i{ first }; i < last; ++i) {
+			const sf::Vector2i* screen{ &cache.screen[(i - first) * vertexCount] };
+			sf::Color color{ instances[cache.visibleInstances[i]].color };
+			if (uniqueEdges) {
+				for (size_t e{ 0 }; e < mesh.edges.size(); e = e + 2) {
+					drawLine(target, screen[mesh.edges[e]], screen[mesh.edges[e + 1]], color);
+				}
+				continue;
+			}
+			for (size_t f{ 0 }; f < mesh.faces.size(); f = f + 3) {
+				const sf::Vector2i& a{ screen[mesh.faces[f]] };
+				const sf::Vector2i& b{ screen[mesh.faces[f + 1]] };
+				const sf::Vector2i& c{ screen[mesh.faces[f + 2]] };
+				if (culling.enabled && isBackFacing(a, b, c, culling.frontFace)) {
+					++culling.culled;
+					continue;
+				}
+				drawTriangle(target, a, b, c, color);
+			}
+			culling.submitted += mesh.faces.size() / 3;
+		}
+	}
+
+	if constexpr (std::is_same_v<RenderTarget, LineBatch>) {
+		target.flush();
+	}
+}
+
+// Times drawing 1,000, 10,000, and 100,000 cubes scattered around the camera (see
+// scatterObjects) into a framebuffer of the given size: with one drawMesh call per cube, and with
+// one drawInstances call for all of them. Checks that both draw the same pixels.
+void benchmarkInstances(const InstancedMesh<uint16_t>& cube, const Frustum& frustum, sf::Vector2u screenSize) {
+	const int REPETITIONS{ 5 };
+	Framebuffer perCall{ screenSize };
+	Framebuffer instanced{ screenSize };
+	VertexCache cache{};
+	BackFaceCulling culling{ false, FrontFace::Clockwise };
+	FrustumCulling frustumCulling{ frustumPlanes(frustum) };
+	sf::Vector3f cameraPosition{ 0, 0, 0 };
+	sf::Vector3f cameraOrientation{ 0, 0, 0 };
+
+	for (size_t count : { 1000, 10000, 100000 }) {
+		std::vector<SceneObject> objects{ scatterObjects(count) };
+		std::vector<Instance> instances;
+		instances.reserve(objects.size());
+		for (const SceneObject& object : objects) {
+			instances.push_back(makeInstance(object.position, object.orientation, object.scale, object.color));
+		}
+
+		// The fastest of a few frames, in milliseconds.
+		auto time{ [&](Framebuffer& framebuffer, const std::function<void()>& draw) {
+			double best{ 0 };
+			for (int i{ 0 }; i < REPETITIONS; ++i) {
+				framebuffer.clear();
+				sf::Clock clock;
+				draw();
+				double ms{ clock.getElapsedTime().asMicroseconds() / 1000.0 };
+				best = i == 0 ? ms : std::min(best, ms);
+			}
+			return best;
+		} };
+		double perCallMs{ time(perCall, [&] {
+			for (const SceneObject& object : objects) {
+				drawMesh(perCall, cache, culling, frustumCulling, frustum, cameraPosition, cameraOrientation,
+					object.position, object.orientation, object.scale, cube.vertices, cube.faces, cube.bounds, object.color);
+			}
+		}) };
+		double instancedMs{ time(instanced, [&] {
+			drawInstances(instanced, cache, culling, frustumCulling, frustum, cameraPosition, cameraOrientation,
+				cube, std::span<const Instance>{ instances }, false);
+		}) };
+		size_t visible{ cache.visibleInstances.size() };
+		bool same{ std::equal(perCall.data(), perCall.data() + screenSize.x * screenSize.y, instanced.data()) };
+		std::cout << count << " cubes (" << visible << " in view): " << perCallMs << " ms with drawMesh, "
+			<< instancedMs << " ms with drawInstances (" << perCallMs / instancedMs << "x, "
+			<< count / instancedMs / 1000 << " million instances per second); "
+			<< (same ? "same pixels" : "pixels differ!") << std::endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	Options options{ parseOptions(argc, argv) };
+	startTrace(options.trace);
+
+	// Headless runs and benchmarks never open a window, so they work on machines without a display.
+	std::optional<sf::RenderWindow> window;
+	if (!options.headless.enabled && !options.benchmarkInstances) {
+		TRACE_SPAN("open window");
+		window.emplace(sf::VideoMode::getFullscreenModes().at(0), "SFML Demo");
+	}
+	sf::Vector2u screenSize{ window ? window->getSize() : options.headless.resolution };
+	Framebuffer framebuffer{ screenSize };
+	VertexCache vertexCache{};
+	BackFaceCulling culling{ options.cull, options.frontFace };
 
 	// Define the vertices and faces of the mesh we're drawing.
 	// These are now LOCAL SPACE COORDINATES. We will separately set the
@@ -158,7 +759,8 @@ int main() {
 		{ -0.5, -0.5, 0.5 },
 		{ 0.5, -0.5, 0.5 }
 	};
-	std::vector<uint32_t> cubeFaces{
+	// With only 8 vertices, the cube's indexes fit in 16 bits, half the memory of 32-bit ones.
+	std::vector<uint16_t> cubeFaces{
 		0, 1, 2,
 		0, 2, 3,
 		4, 0, 3,
@@ -172,6 +774,7 @@ int main() {
 		2, 6, 7,
 		2, 7, 3
 	};
+	InstancedMesh<uint16_t> cube{ cubeVertices, cubeFaces, extractEdges(cubeFaces), computeBounds(cubeVertices) };
 
 	// Move "back" away from the camera.
 	sf::Vector3f position1{ sf::Vector3f{-1.5, 0, 0} };
@@ -188,11 +791,21 @@ int main() {
 	sf::Vector3f orientation3{ sf::Vector3f{0, 0, std::numbers::pi_v<float> / 12} };
 	sf::Vector3f scale3{ sf::Vector3f{1, 1, 1} };
 
+	// Every cube in the scene, drawn with one drawInstances call: the three above, then the
+	// scattered ones. Only the first cube moves, so only its transform is recompiled each frame.
+	std::vector<Instance> cubes{
+		makeInstance(position1, orientation1, scale1, sf::Color::Red),
+		makeInstance(position2, orientation2, scale2, sf::Color::Green),
+		makeInstance(position3, orientation3, scale3, sf::Color::Blue)
+	};
+	for (const SceneObject& object : scatterObjects(options.scatteredCubes)) {
+		cubes.push_back(makeInstance(object.position, object.orientation, object.scale, object.color));
+	}
 
 	// Construct the frustum. Start with parameters near, far, fovy, and aspect ratio
 	// to compute right and top.
 	float fovy{ 60.0f };
-	float ratio{ static_cast<float>(window.getSize().x) / (window.getSize().y) };
+	float ratio{ static_cast<float>(screenSize.x) / (screenSize.y) };
 	float near{ 0.1f };
 	float far{ 100.0f };
 	float t{ static_cast<float>(near * tan((fovy * std::numbers::pi_v<float> / 180.0f) / 2)) };
@@ -200,18 +813,48 @@ int main() {
 	float r{ t * ratio };
 	float l{ -r };
 	Frustum frustum{ near, far, l, r, b, t };
+	FrustumCulling frustumCulling{ frustumPlanes(frustum) };
 
 	// Position the camera.
 	sf::Vector3f cameraPosition{ 0, 0, 3 };
 	sf::Vector3f cameraOrientation{ 0, 0, 0 };
 
 
-	auto last{ c.getElapsedTime() };
-	while (window.isOpen()) {
+	if (options.benchmarkInstances) {
+		benchmarkInstances(cube, frustum, screenSize);
+		finishTrace();
+		return 0;
+	}
+
+	// Draws every object in the scene into one of the render targets.
+	auto drawScene{ [&](auto& target) {
+		drawInstances(target, vertexCache, culling, frustumCulling, frustum, cameraPosition, cameraOrientation,
+			cube, std::span<const Instance>{ cubes }, options.uniqueEdges);
+	} };
+
+	if (options.headless.enabled) {
+		// The same work as each frame of the loop below, without events or a window to present to.
+		int result{ runHeadless(options.headless, framebuffer, [&] {
+			advanceTraceFrame();
+			TRACE_SPAN("frame");
+			orientation1.y += 0.0001f;
+			cubes[0] = makeInstance(position1, orientation1, scale1, sf::Color::Red);
+			framebuffer.clear();
+			drawScene(framebuffer);
+		}) };
+		finishTrace();
+		return result;
+	}
+
+	LineBatch batch{ *window };
+	while (window->isOpen()) {
+		advanceTraceFrame();
+		PROFILE_STAGE(ProfileStage::Frame);
+		TRACE_SPAN("frame");
 		// Check for events.
-		while (const std::optional event{ window.pollEvent() }) {
+		while (const std::optional event{ window->pollEvent() }) {
 			if (event->is<sf::Event::Closed>()) {
-				window.close();
+				window->close();
 			}
 		}
 
@@ -232,25 +875,53 @@ int main() {
 			cameraOrientation = { 0, std::numbers::pi_v<float> / 6, 0 };
 		}
 
-#ifdef LOG_FPS
-		// FPS calculation.
-		auto now{ c.getElapsedTime() };
-		auto diff{ now - last };
-		std::cout << 1 / diff.asSeconds() << " FPS " << std::endl;
-		last = now;
+#ifdef ENABLE_PROFILER
+		if (stageProfiler().reportDue()) {
+			stageProfiler().report(std::cout);
+			std::cout << vertexCache.verticesTransformed << " vertices transformed";
+			vertexCache.verticesTransformed = 0;
+			std::cout << ", " << frustumCulling.culled << " of " << frustumCulling.submitted << " objects outside the frustum";
+			frustumCulling.submitted = 0;
+			frustumCulling.culled = 0;
+			if (culling.enabled) {
+				std::cout << ", " << culling.culled << " of " << culling.submitted << " triangles culled";
+				culling.submitted = 0;
+				culling.culled = 0;
+			}
+			std::cout << std::endl;
+		}
 #endif
 
 		// Rotate the cube by incrementing the orientation. This is a "yaw" around the y axis.
 		orientation1.y += 0.0001f;
+		cubes[0] = makeInstance(position1, orientation1, scale1, sf::Color::Red);
 
 		// Render the scene.
-		window.clear();
-		drawMesh(window, frustum, cameraPosition, cameraOrientation, position1, orientation1, scale1, cubeVertices, cubeFaces, sf::Color::Red);
-		drawMesh(window, frustum, cameraPosition, cameraOrientation, position2, orientation2, scale2, cubeVertices, cubeFaces, sf::Color::Green);
-		drawMesh(window, frustum, cameraPosition, cameraOrientation, position3, orientation3, scale3, cubeVertices, cubeFaces, sf::Color::Blue);
-		window.display();
+		switch (options.submission) {
+		case SubmissionMode::Immediate:
+			window->clear();
+			drawScene(*window);
+			break;
+		case SubmissionMode::Batched:
+			window->clear();
+			drawScene(batch);
+			break;
+		case SubmissionMode::Framebuffer:
+			framebuffer.clear();
+			drawScene(framebuffer);
+			break;
+		}
+		PROFILE_STAGE(ProfileStage::Present);
+		TRACE_SPAN("present");
+		if (options.submission == SubmissionMode::Framebuffer) {
+			TRACE_SPAN("framebuffer.present");
+			framebuffer.present(*window);
+		}
+		TRACE_SPAN("window.display");
+		window->display();
 	}
 
+	finishTrace();
 	return 0;
 }
 
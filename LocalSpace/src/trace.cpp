@@ -0,0 +1,193 @@
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+const char* const TRACE_USAGE{ "[--trace FILE.json [--trace-frames N]]" };
+
+namespace {
+	// A thread stops recording once its buffer holds this many spans, so a long trace of a busy
+	// scene cannot use up all the memory. Spans past the limit are counted and reported.
+	const size_t MAX_SPANS_PER_THREAD{ 1 << 20 };
+
+	struct Span {
+		const char* name;
+		int64_t start;    // Nanoseconds since the trace started.
+		int64_t duration; // Nanoseconds.
+	};
+
+	// The spans of one thread. Only that thread appends to it while recording, so recording takes
+	// no lock; the file is written once every other thread is idle.
+	struct ThreadSpans {
+		std::string name;
+		size_t id;
+		std::vector<Span> spans;
+		size_t dropped{ 0 };
+	};
+
+	struct Trace {
+		std::atomic<bool> active{ false };
+		std::string path;
+		size_t frameLimit{ 0 };
+		size_t framesStarted{ 0 };
+		TraceSpan::Clock::time_point origin;
+		// Registering a thread is the only step that locks.
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadSpans>> threads;
+	};
+
+	Trace& trace() {
+		static Trace instance;
+		return instance;
+	}
+
+	thread_local ThreadSpans* currentThread{ nullptr };
+
+	ThreadSpans& threadSpans() {
+		if (currentThread == nullptr) {
+			Trace& t{ trace() };
+			std::lock_guard lock{ t.mutex };
+			t.threads.push_back(std::make_unique<ThreadSpans>());
+			currentThread = t.threads.back().get();
+			currentThread->id = t.threads.size();
+			currentThread->name = "thread " + std::to_string(currentThread->id);
+		}
+		return *currentThread;
+	}
+
+	int64_t nanosecondsSince(TraceSpan::Clock::time_point origin, TraceSpan::Clock::time_point time) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time - origin).count();
+	}
+
+	// Stops recording and writes every thread's spans as complete ("X") events, with their times
+	// in microseconds, and a metadata event naming each thread.
+	void writeTrace(size_t frames) {
+		Trace& t{ trace() };
+		t.active = false;
+
+		std::ofstream out{ t.path };
+		if (!out) {
+			std::cout << "Could not write the trace to " << t.path << std::endl;
+			return;
+		}
+		size_t spanCount{ 0 };
+		size_t dropped{ 0 };
+		// Nanosecond resolution, whatever the size of the timestamp.
+		out << std::fixed << std::setprecision(3);
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		out << "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"renderer\"}}";
+		for (const std::unique_ptr<ThreadSpans>& thread : t.threads) {
+			out << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+				<< ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << thread->name << "\"}}";
+			out << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+				<< ",\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":" << thread->id << "}}";
+			// Spans are recorded as they end, so inner spans come before the spans around them.
+			// Viewers nest spans more reliably in order of their start, outermost first.
+			std::sort(thread->spans.begin(), thread->spans.end(), [](const Span& a, const Span& b) {
+				return a.start != b.start ? a.start < b.start : a.duration > b.duration;
+			});
+			for (const Span& span : thread->spans) {
+				out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id << ",\"name\":\"" << span.name
+					<< "\",\"ts\":" << span.start / 1000.0 << ",\"dur\":" << span.duration / 1000.0 << "}";
+			}
+			spanCount += thread->spans.size();
+			dropped += thread->dropped;
+		}
+		out << "\n]}\n";
+
+		std::cout << "Wrote " << spanCount << " spans from " << t.threads.size() << " threads over " << frames
+			<< " frames to " << t.path;
+		if (dropped > 0) {
+			std::cout << " (" << dropped << " spans dropped once a thread's buffer was full)";
+		}
+		std::cout << std::endl;
+	}
+}
+
+bool parseTraceOption(int argc, char* argv[], int& i, TraceOptions& options) {
+	std::string_view arg{ argv[i] };
+	if (arg != "--trace" && arg != "--trace-frames") {
+		return false;
+	}
+	if (i + 1 >= argc) {
+		std::cout << arg << " needs a value" << std::endl;
+		exit(1);
+	}
+	std::string_view value{ argv[++i] };
+	if (arg == "--trace") {
+		options.path = value;
+	}
+	else {
+		auto [end, error] { std::from_chars(value.data(), value.data() + value.size(), options.frames) };
+		if (error != std::errc{} || end != value.data() + value.size() || options.frames == 0) {
+			std::cout << "--trace-frames needs a positive number, not " << value << std::endl;
+			exit(1);
+		}
+	}
+	return true;
+}
+
+void startTrace(const TraceOptions& options) {
+	if (options.path.empty()) {
+		return;
+	}
+	Trace& t{ trace() };
+	t.path = options.path;
+	t.frameLimit = options.frames;
+	t.origin = TraceSpan::Clock::now();
+	threadSpans().name = "main";
+	t.active = true;
+}
+
+bool traceActive() {
+	return trace().active.load(std::memory_order_relaxed);
+}
+
+void nameTraceThread(const std::string& name) {
+	if (traceActive()) {
+		threadSpans().name = name;
+	}
+}
+
+void advanceTraceFrame() {
+	Trace& t{ trace() };
+	if (!t.active) {
+		return;
+	}
+	if (t.framesStarted == t.frameLimit) {
+		writeTrace(t.framesStarted);
+		return;
+	}
+	++t.framesStarted;
+}
+
+void finishTrace() {
+	Trace& t{ trace() };
+	if (t.active) {
+		writeTrace(t.framesStarted);
+	}
+}
+
+TraceSpan::~TraceSpan() {
+	// A span that began before the trace stopped is dropped, not written to a finished file.
+	if (m_name == nullptr || !traceActive()) {
+		return;
+	}
+	TraceSpan::Clock::time_point end{ Clock::now() };
+	ThreadSpans& thread{ threadSpans() };
+	if (thread.spans.size() >= MAX_SPANS_PER_THREAD) {
+		++thread.dropped;
+		return;
+	}
+	int64_t start{ nanosecondsSince(trace().origin, m_start) };
+	thread.spans.push_back(Span{ m_name, start, nanosecondsSince(trace().origin, end) - start });
+}
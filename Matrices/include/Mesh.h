@@ -1,4 +1,8 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <variant>
 #include <vector>
 
 struct Vertex3D {
@@ -7,8 +11,30 @@ struct Vertex3D {
 	float z;
 };
 
+// A triangle mesh whose face indexes are stored as Index, either uint16_t or uint32_t. Most of our
+// meshes have far fewer than 65536 vertices, and storing their faces in 16 bits halves the memory
+// the faces take and the bandwidth spent reading them every frame.
+template <typename Index>
 class Mesh {
+public:
+	using IndexType = Index;
+	static constexpr size_t INDEX_BYTES{ sizeof(Index) };
+
+	Mesh(std::vector<Vertex3D> vertices, std::vector<Index> faces)
+		: m_vertices{ std::move(vertices) }, m_faces{ std::move(faces) } {
+	}
+
+	const std::vector<Vertex3D>& vertices() const { return m_vertices; }
+	const std::vector<Index>& faces() const { return m_faces; }
+
 private:
 	std::vector<Vertex3D> m_vertices;
-	std::vector<uint32_t> m_faces;
-};
\ No newline at end of file
+	std::vector<Index> m_faces;
+};
+
+// The most vertices 16-bit indexes can address.
+const size_t MAX_16_BIT_VERTICES{ 65536 };
+
+// A mesh with whichever index width its loader picked: the narrowest that fits its vertex count.
+// Code that draws it uses std::visit to get at the Mesh inside with its real index type.
+using AnyMesh = std::variant<Mesh<uint16_t>, Mesh<uint32_t>>;
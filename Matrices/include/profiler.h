@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+
+// Frame and pipeline stage timing. Scoped timers record how long each stage of a frame takes, and
+// the main loop prints the 50th, 95th, and 99th percentile frame and stage times about once a
+// second. Configure with -DENABLE_PROFILER=OFF to compile all of it out: PROFILE_STAGE then
+// expands to nothing, and the demos' #ifdef ENABLE_PROFILER blocks disappear with it.
+
+// The stages we time. Each demo times the ones it has as separate steps.
+enum class ProfileStage : uint8_t {
+	Frame,     // One whole iteration of the main loop.
+	Transform, // Moving vertices from local space to screen space.
+	Clip,      // Frustum culling, and culling, clipping, and assembling triangles.
+	Raster,    // Drawing lines or filling triangles.
+	Present,   // Handing the finished frame to the window.
+	Count
+};
+
+#ifdef ENABLE_PROFILER
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+// Collects timing samples in a fixed ring buffer. Any thread can record without taking a lock:
+// each sample claims a slot with one atomic increment and is written with one atomic store. If
+// more than CAPACITY samples arrive between two reports, the oldest are overwritten.
+class StageProfiler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr size_t CAPACITY{ 1 << 18 };
+
+	void record(ProfileStage stage, Clock::duration duration);
+
+	// True once a second has passed since the last report.
+	bool reportDue() const { return Clock::now() - m_lastReport >= std::chrono::seconds{ 1 }; }
+
+	// Prints the frame rate and the percentiles of each stage's time per frame (a stage that runs
+	// once per object is summed over the frame) since the last report, then starts a new period.
+	// Stages that recorded nothing are left out. Writes the whole summary with one flush.
+	void report(std::ostream& out);
+
+private:
+	std::array<std::atomic<uint64_t>, CAPACITY> m_slots;
+	std::atomic<uint64_t> m_next{ 0 };
+	std::atomic<uint32_t> m_frame{ 0 };
+	uint64_t m_reported{ 0 };
+	Clock::time_point m_lastReport{ Clock::now() };
+	// Per-frame totals for each stage while reporting, kept to reuse their memory.
+	std::array<std::vector<double>, static_cast<size_t>(ProfileStage::Count)> m_totals;
+};
+
+// The profiler shared by the whole program.
+StageProfiler& stageProfiler();
+
+// Records the time from its construction to the end of the enclosing scope.
+class ScopedStageTimer {
+public:
+	explicit ScopedStageTimer(ProfileStage stage) : m_stage{ stage }, m_start{ StageProfiler::Clock::now() } {}
+	~ScopedStageTimer() { stageProfiler().record(m_stage, StageProfiler::Clock::now() - m_start); }
+
+	ScopedStageTimer(const ScopedStageTimer&) = delete;
+	ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+	ProfileStage m_stage;
+	StageProfiler::Clock::time_point m_start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing scope as the given stage.
+#define PROFILE_STAGE(stage) ScopedStageTimer PROFILE_CONCAT(profileStage, __LINE__){ stage }
+#else
+#define PROFILE_STAGE(stage)
+#endif
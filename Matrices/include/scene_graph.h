@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/ext.hpp>
+
+// A hierarchy of transforms. Every node has a local transform, relative to its parent, and a world
+// transform: its parent's world transform times its local one, or just its local one if it has no
+// parent. Moving a node moves everything below it.
+//
+// Nodes live in flat arrays indexed by NodeId, and a node's parent must already exist when the node
+// is added, so every parent comes before all of its children. That lets updateWorldTransforms
+// compute the world transforms in one front-to-back sweep: by the time we reach a node, its
+// parent's world transform is already up to date. Setting a local transform only marks the node
+// dirty; the sweep recomputes a node only if it is dirty or its parent was recomputed in the same
+// sweep, so a frame where a few nodes move costs a few matrix products, not one per node.
+class SceneGraph {
+public:
+	using NodeId = uint32_t;
+	static constexpr NodeId NO_PARENT{ UINT32_MAX };
+
+	// Adds a node below `parent` (or NO_PARENT for a root) and returns its id. Its world transform
+	// is computed by the next call to updateWorldTransforms.
+	NodeId addNode(NodeId parent, const glm::mat4& localTransform);
+
+	// Replaces a node's local transform, and marks it dirty.
+	void setLocalTransform(NodeId node, const glm::mat4& localTransform);
+
+	const glm::mat4& localTransform(NodeId node) const { return m_local[node]; }
+	// The world transform as of the last call to updateWorldTransforms.
+	const glm::mat4& worldTransform(NodeId node) const { return m_world[node]; }
+	NodeId parent(NodeId node) const { return m_parents[node]; }
+	size_t size() const { return m_parents.size(); }
+
+	// Recomputes the world transforms of every dirty node and all of their descendants, and clears
+	// the dirty marks. Returns how many world transforms were recomputed.
+	size_t updateWorldTransforms();
+
+	// Recomputes every world transform, dirty or not. For measuring what the dirty marks save.
+	void recomputeAllWorldTransforms();
+
+private:
+	std::vector<NodeId> m_parents;
+	std::vector<glm::mat4> m_local;
+	std::vector<glm::mat4> m_world;
+	std::vector<uint8_t> m_dirty;
+	// The sweep in which each node's world transform was last recomputed. A child compares its
+	// parent's entry to the current sweep, so no marks ever need to be cleared from descendants.
+	std::vector<uint32_t> m_updatedIn;
+	uint32_t m_sweep{ 0 };
+	// No node before this one is dirty, so the sweep can start here.
+	size_t m_firstDirty{ 0 };
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Mesh.h"
+
+// Mesh positions in structure-of-arrays layout: every x coordinate, then every y, then every z.
+// SIMD code can load the same coordinate of 8 consecutive vertices with a single instruction,
+// instead of gathering it out of 8 separate Vertex3D structs.
+struct PositionsSoA {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+};
+
+// Integer screen coordinates of transformed vertices, in the same layout.
+struct ScreenPositionsSoA {
+	std::vector<int32_t> x;
+	std::vector<int32_t> y;
+};
+
+PositionsSoA toStructureOfArrays(const std::vector<Vertex3D>& vertices);
+
+// Instruction sets the transform can use, from narrowest to widest.
+enum class SimdLevel {
+	Scalar, // One vertex per iteration.
+	SSE,    // 4 vertices per iteration.
+	AVX2    // 8 vertices per iteration, with fused multiply-add.
+};
+
+// The widest level that both this CPU and the operating system support. Checked once, then cached.
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// Multiplies every position by a column-major 4x4 model-view-projection matrix (for example,
+// glm::value_ptr of a glm::mat4), divides by w, and maps the result to a viewport of the given
+// size the same way clipToScreen does, in one pass. Coordinates that land absurdly far off screen
+// (such as from vertices with w near 0) are clamped to +/- 2^30 rather than overflowing.
+void transformToScreen(const float* mvp, const PositionsSoA& positions,
+	float viewportWidth, float viewportHeight, ScreenPositionsSoA& screen, SimdLevel level);
+void transformToScreen(const float* mvp, const PositionsSoA& positions,
+	float viewportWidth, float viewportHeight, ScreenPositionsSoA& screen);
@@ -10,15 +10,23 @@
 #include <vector>
 #include <numbers>
 #include <cmath>
+#include <variant>
+#include <random>
+#include <string_view>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 #include "triangles.h"
 #include "Mesh.h"
+#include "vertex_transform.h"
+#include "profiler.h"
+#include "scene_graph.h"
 
 
-#define LOG_FPS
+// Comment out to submit every line to the window with its own draw call, instead of
+// rasterizing into our own framebuffer and presenting it once per frame.
+#define USE_FRAMEBUFFER
 
 struct Frustum {
 	float near;
@@ -32,10 +40,13 @@ struct Frustum {
 const size_t FLOATS_PER_VERTEX{ 3 };
 const size_t VERTICES_PER_FACE{ 3 };
 
-// Reads the vertices and faces of an Assimp mesh, and uses them to initialize mesh structures
-// compatible with the rest of our application.
-void fromAssimpMesh(const aiMesh* mesh, std::vector<Vertex3D>& vertices,
-	std::vector<uint32_t>& faces) {
+// Reads the vertices and faces of an Assimp mesh, and uses them to initialize a mesh structure
+// compatible with the rest of our application, with face indexes of the given width.
+template <typename Index>
+Mesh<Index> fromAssimpMesh(const aiMesh* mesh) {
+	std::vector<Vertex3D> vertices{};
+	std::vector<Index> faces{};
+	vertices.reserve(mesh->mNumVertices);
 	for (size_t i{ 0 }; i < mesh->mNumVertices; ++i) {
 		// Each "vertex" from Assimp has to be transformed into a Vertex3D in our application.
 		vertices.push_back({ mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z });
@@ -44,15 +55,16 @@ void fromAssimpMesh(const aiMesh* mesh, std::vector<Vertex3D>& vertices,
 	faces.reserve(mesh->mNumFaces * VERTICES_PER_FACE);
 	for (size_t i{ 0 }; i < mesh->mNumFaces; ++i) {
 		// We assume the faces are triangular, so we push three face indexes at a time into our faces list.
-		faces.push_back(mesh->mFaces[i].mIndices[0]);
-		faces.push_back(mesh->mFaces[i].mIndices[1]);
-		faces.push_back(mesh->mFaces[i].mIndices[2]);
+		faces.push_back(static_cast<Index>(mesh->mFaces[i].mIndices[0]));
+		faces.push_back(static_cast<Index>(mesh->mFaces[i].mIndices[1]));
+		faces.push_back(static_cast<Index>(mesh->mFaces[i].mIndices[2]));
 	}
+	return Mesh<Index>{ std::move(vertices), std::move(faces) };
 }
 
-// Loads an asset file supported by Assimp, extracts the first mesh in the file, and fills in the 
-// given vertices and faces lists with its data.
-void assimpLoad(const std::string& path, std::vector<Vertex3D>& vertices, std::vector<uint32_t>& faces) {
+// Loads an asset file supported by Assimp and extracts the first mesh in the file, with 16-bit
+// face indexes if it has few enough vertices for them and 32-bit ones otherwise.
+AnyMesh assimpLoad(const std::string& path) {
 	Assimp::Importer importer{};
 
 	const aiScene* scene{ importer.ReadFile(path, aiProcessPreset_TargetRealtime_MaxQuality) };
@@ -62,9 +74,11 @@ void assimpLoad(const std::string& path, std::vector<Vertex3D>& vertices, std::v
 		std::cout << "ASSIMP ERROR" << importer.GetErrorString() << std::endl;
 		exit(1);
 	}
-	else {
-		fromAssimpMesh(scene->mMeshes[0], vertices, faces);
+	const aiMesh* mesh{ scene->mMeshes[0] };
+	if (mesh->mNumVertices <= MAX_16_BIT_VERTICES) {
+		return fromAssimpMesh<uint16_t>(mesh);
 	}
+	return fromAssimpMesh<uint32_t>(mesh);
 }
 
 glm::mat4 buildModelMatrix(const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale) {
@@ -80,60 +94,142 @@ sf::Vector2i clipToScreen(const sf::View& viewport, const Vertex3D& clip) {
 	return sf::Vector2i{ xs, ys };
 }
 
-void drawMesh(sf::RenderWindow& window,
+// RenderTarget is either the sf::RenderWindow itself, or a Framebuffer that we draw into.
+// The mesh's positions come in structure-of-arrays form (see toStructureOfArrays), and `screen`
+// is scratch space for their transformed coordinates, kept by the caller between frames. Index is
+// the width of the mesh's face indexes (see Mesh.h).
+template <typename RenderTarget, typename Index>
+void drawMesh(RenderTarget& target,
 	const glm::mat4& modelMatrix,
 	const glm::mat4& viewMatrix,
 	const glm::mat4& projectionMatrix,
-	const std::vector<Vertex3D>& vertices,
-	const std::vector<uint32_t>& faces,
+	const PositionsSoA& positions,
+	const std::vector<Index>& faces,
+	ScreenPositionsSoA& screen,
 	sf::Color color) {
 
 	// TODO: first, construct a new 4x4 "MVP" matrix, by multiplying the
 	// model, view, and projection matrices as shown in lecture. The order matters!!!
 	glm::mat4 mvp{};
 
+	// Transform every vertex by the MVP matrix, divide by w, and map to screen coordinates in a
+	// single pass, 8 vertices at a time where the CPU supports it.
+	auto& viewport{ target.getView() };
+	{
+		PROFILE_STAGE(ProfileStage::Transform);
+		transformToScreen(glm::value_ptr(mvp), positions, viewport.getSize().x, viewport.getSize().y, screen);
+	}
+
 	// Loop through the list of face indexes, 3 at a time.
-	// Pull each vertex out of the vertices list.
-	// Transform them from clip coordinates to screen coordinates.
+	// Look up the screen coordinates of each corner.
 	// Draw a triangle connecting them.
+	PROFILE_STAGE(ProfileStage::Raster);
 	for (size_t i = 0; i < faces.size(); i = i + 3) {
-		auto& localA{ vertices[faces[i]] };
-		auto& localB{ vertices[faces[i + 1]] };
-		auto& localC{ vertices[faces[i + 2]] };
-
-		// TODO: transform vertexA, vertexB, and vertexC to clip space,
-		// by using the MVP matrix you constructed.
-		auto clipA{ localA };
-		auto clipB{ localB };
-		auto clipC{ localC };
-
-		auto& viewport{ window.getView() };
-		auto screenA{ clipToScreen(viewport, clipA) };
-		auto screenB{ clipToScreen(viewport, clipB) };
-		auto screenC{ clipToScreen(viewport, clipC) };
-
-		drawTriangle(window,
-			sf::Vector2i{ screenA.x, screenA.y },
-			sf::Vector2i{ screenB.x, screenB.y },
-			sf::Vector2i{ screenC.x, screenC.y },
+		Index a{ faces[i] };
+		Index b{ faces[i + 1] };
+		Index c{ faces[i + 2] };
+
+		drawTriangle(target,
+			sf::Vector2i{ screen.x[a], screen.y[a] },
+			sf::Vector2i{ screen.x[b], screen.y[b] },
+			sf::Vector2i{ screen.x[c], screen.y[c] },
 			color
 		);
 	}
 }
 
+// Times updating a scene graph of a million nodes when 1% of them move each frame, against
+// recomputing every world transform. The nodes form a tree where each node has up to 8 children,
+// added level by level, so most of them are leaves and moving one rarely moves many others.
+void benchmarkSceneGraph() {
+	const size_t NODE_COUNT{ 1'000'000 };
+	const size_t CHILDREN_PER_NODE{ 8 };
+	const int FRAMES{ 20 };
+	std::mt19937 random{ 449 };
+	std::uniform_real_distribution<float> offset{ -1.0f, 1.0f };
+	std::uniform_real_distribution<float> angle{ -std::numbers::pi_v<float>, std::numbers::pi_v<float> };
+	std::uniform_int_distribution<SceneGraph::NodeId> anyNode{ 0, NODE_COUNT - 1 };
+
+	// A random offset from the parent and a random yaw around it, built directly with glm so the
+	// benchmark does not depend on buildModelMatrix being finished.
+	auto randomTransform{ [&] {
+		glm::mat4 translated{ glm::translate(glm::mat4{ 1 }, glm::vec3{ offset(random), offset(random), offset(random) }) };
+		return glm::rotate(translated, angle(random), glm::vec3{ 0, 1, 0 });
+	} };
+	SceneGraph scene{};
+	scene.addNode(SceneGraph::NO_PARENT, randomTransform());
+	for (size_t i{ 1 }; i < NODE_COUNT; ++i) {
+		scene.addNode(static_cast<SceneGraph::NodeId>((i - 1) / CHILDREN_PER_NODE), randomTransform());
+	}
+	scene.updateWorldTransforms();
+
+	double dirtyMs{ 0 };
+	double fullMs{ 0 };
+	size_t updated{ 0 };
+	for (int frame{ 0 }; frame < FRAMES; ++frame) {
+		for (size_t i{ 0 }; i < NODE_COUNT / 100; ++i) {
+			scene.setLocalTransform(anyNode(random), randomTransform());
+		}
+		sf::Clock clock;
+		updated += scene.updateWorldTransforms();
+		dirtyMs += clock.restart().asMicroseconds() / 1000.0;
+		scene.recomputeAllWorldTransforms();
+		fullMs += clock.getElapsedTime().asMicroseconds() / 1000.0;
+	}
+	std::cout << NODE_COUNT << " nodes, " << NODE_COUNT / 100 << " moved per frame: "
+		<< updated / FRAMES << " world transforms recomputed in " << dirtyMs / FRAMES << " ms, against "
+		<< fullMs / FRAMES << " ms to recompute all of them (" << fullMs / dirtyMs << "x)" << std::endl;
+}
+
+struct Options {
+	// --benchmark-scene-graph: time updating a large scene graph, then exit.
+	bool benchmarkSceneGraph{ false };
+};
+
+Options parseOptions(int argc, char* argv[]) {
+	Options options{};
+	for (int i{ 1 }; i < argc; ++i) {
+		std::string_view arg{ argv[i] };
+		if (arg == "--benchmark-scene-graph") {
+			options.benchmarkSceneGraph = true;
+		}
+		else {
+			std::cout << "Unknown option " << arg << std::endl;
+			std::cout << "Usage: " << argv[0] << " [--benchmark-scene-graph]" << std::endl;
+			exit(1);
+		}
+	}
+	return options;
+}
+
+int main(int argc, char* argv[]) {
+	Options options{ parseOptions(argc, argv) };
+	if (options.benchmarkSceneGraph) {
+		benchmarkSceneGraph();
+		return 0;
+	}
 
-int main() {
 	sf::RenderWindow window{ sf::VideoMode::getFullscreenModes().at(0), "SFML Demo" };
-	sf::Clock c;
+	Framebuffer framebuffer{ window.getSize() };
 
-	std::vector<Vertex3D> bunnyVertices{};
-	std::vector<uint32_t> bunnyFaces{};
-	assimpLoad("models/bunny.obj", bunnyVertices, bunnyFaces);
+	AnyMesh bunny{ assimpLoad("models/bunny.obj") };
+	PositionsSoA bunnyPositions{};
+	std::visit([&bunnyPositions](const auto& mesh) {
+		bunnyPositions = toStructureOfArrays(mesh.vertices());
+		std::cout << "Loaded the bunny with " << mesh.INDEX_BYTES * 8 << "-bit indexes" << std::endl;
+	}, bunny);
+	ScreenPositionsSoA screenPositions{};
+	std::cout << "Transforming vertices with " << simdLevelName(detectSimdLevel()) << std::endl;
 
 	glm::vec3 bunnyPosition{ 0, -1, -2.5 };
 	glm::vec3 bunnyOrientation{ 0, 0, 0 };
 	glm::vec3 bunnyScale{ 9, 9, 9 };
 
+	// The bunny is the only node of the scene for now. Its world transform is recomputed only in
+	// frames where its local transform changes.
+	SceneGraph scene{};
+	SceneGraph::NodeId bunnyNode{ scene.addNode(SceneGraph::NO_PARENT, buildModelMatrix(bunnyPosition, bunnyOrientation, bunnyScale)) };
+
 	float fovy{ 60.0f };
 	float ratio{ static_cast<float>(window.getSize().x) / (window.getSize().y) };
 	float near{ 0.1f };
@@ -143,8 +239,8 @@ int main() {
 	float r{ t * ratio };
 	float l{ -r };
 
-	auto last{ c.getElapsedTime() };
 	while (window.isOpen()) {
+		PROFILE_STAGE(ProfileStage::Frame);
 		// Check for events.
 		while (const std::optional event{ window.pollEvent() }) {
 			if (event->is<sf::Event::Closed>()) {
@@ -152,24 +248,36 @@ int main() {
 			}
 		}
 
-#ifdef LOG_FPS
-		// FPS calculation.
-		auto now{ c.getElapsedTime() };
-		auto diff{ now - last };
-		std::cout << 1 / diff.asSeconds() << " FPS " << std::endl;
-		last = now;
+#ifdef ENABLE_PROFILER
+		if (stageProfiler().reportDue()) {
+			stageProfiler().report(std::cout);
+		}
 #endif
 
 		// Rotate the bunny by incrementing the orientation. This is a "yaw" around the y axis.
 		bunnyOrientation.y += 0.001f;
 
-		glm::mat4 bunnyModelMatrix{ buildModelMatrix(bunnyPosition, bunnyOrientation, bunnyScale) };
+		scene.setLocalTransform(bunnyNode, buildModelMatrix(bunnyPosition, bunnyOrientation, bunnyScale));
+		scene.updateWorldTransforms();
+		const glm::mat4& bunnyModelMatrix{ scene.worldTransform(bunnyNode) };
 		glm::mat4 viewMatrix{ 1 }; // identity matrix == camera at origin, looking down -z axis.
 		glm::mat4 projectionMatrix{ 1 };
 
 		// Render the scene.
+#ifdef USE_FRAMEBUFFER
+		framebuffer.clear();
+		std::visit([&](const auto& mesh) {
+			drawMesh(framebuffer, bunnyModelMatrix, viewMatrix, projectionMatrix, bunnyPositions, mesh.faces(), screenPositions, sf::Color::White);
+		}, bunny);
+		PROFILE_STAGE(ProfileStage::Present);
+		framebuffer.present(window);
+#else
 		window.clear();
-		drawMesh(window, bunnyModelMatrix, viewMatrix, projectionMatrix, bunnyVertices, bunnyFaces, sf::Color::White);
+		std::visit([&](const auto& mesh) {
+			drawMesh(window, bunnyModelMatrix, viewMatrix, projectionMatrix, bunnyPositions, mesh.faces(), screenPositions, sf::Color::White);
+		}, bunny);
+		PROFILE_STAGE(ProfileStage::Present);
+#endif
 		window.display();
 	}
 
@@ -0,0 +1,103 @@
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+	// Each slot packs a sample into one 64-bit value, so it can be written with a single atomic
+	// store: the stage in the top 4 bits, the low 20 bits of the frame number it belongs to in the
+	// next 20, and the duration in nanoseconds (up to about 18 minutes) in the low 40.
+	const int FRAME_SHIFT{ 40 };
+	const int STAGE_SHIFT{ 60 };
+	const uint64_t FRAME_MASK{ (uint64_t{ 1 } << 20) - 1 };
+	const uint64_t DURATION_MASK{ (uint64_t{ 1 } << FRAME_SHIFT) - 1 };
+
+	const char* const STAGE_NAMES[]{ "frame", "transform", "clip", "raster", "present" };
+
+	// The value below which the given fraction of the samples fall. Reorders the samples.
+	double percentile(std::vector<double>& samples, double fraction) {
+		size_t index{ static_cast<size_t>(fraction * (samples.size() - 1) + 0.5) };
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+		return samples[index];
+	}
+}
+
+void StageProfiler::record(ProfileStage stage, Clock::duration duration) {
+	uint64_t nanoseconds{ static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()) };
+	uint64_t frame{ m_frame.load(std::memory_order_relaxed) };
+	uint64_t sample{ (static_cast<uint64_t>(stage) << STAGE_SHIFT) | ((frame & FRAME_MASK) << FRAME_SHIFT)
+		| std::min(nanoseconds, DURATION_MASK) };
+	uint64_t index{ m_next.fetch_add(1, std::memory_order_relaxed) };
+	m_slots[index % CAPACITY].store(sample, std::memory_order_release);
+	if (stage == ProfileStage::Frame) {
+		m_frame.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void StageProfiler::report(std::ostream& out) {
+	uint64_t end{ m_next.load(std::memory_order_acquire) };
+	uint64_t begin{ std::max(m_reported, end > CAPACITY ? end - CAPACITY : 0) };
+	uint64_t dropped{ begin - m_reported };
+
+	// Sum each stage's samples per frame. A frame's samples are recorded one after another, so a
+	// change of frame number closes the running total.
+	for (auto& totals : m_totals) {
+		totals.clear();
+	}
+	std::array<uint64_t, static_cast<size_t>(ProfileStage::Count)> currentFrame{};
+	std::array<double, static_cast<size_t>(ProfileStage::Count)> running{};
+	std::array<bool, static_cast<size_t>(ProfileStage::Count)> open{};
+	for (uint64_t i{ begin }; i < end; ++i) {
+		uint64_t sample{ m_slots[i % CAPACITY].load(std::memory_order_acquire) };
+		size_t stage{ static_cast<size_t>(sample >> STAGE_SHIFT) };
+		uint64_t frame{ (sample >> FRAME_SHIFT) & FRAME_MASK };
+		double milliseconds{ (sample & DURATION_MASK) / 1e6 };
+		if (stage >= m_totals.size()) {
+			continue;
+		}
+		if (open[stage] && currentFrame[stage] != frame) {
+			m_totals[stage].push_back(running[stage]);
+			running[stage] = 0.0;
+		}
+		open[stage] = true;
+		currentFrame[stage] = frame;
+		running[stage] += milliseconds;
+	}
+	for (size_t stage{ 0 }; stage < m_totals.size(); ++stage) {
+		if (open[stage]) {
+			m_totals[stage].push_back(running[stage]);
+		}
+	}
+
+	auto now{ Clock::now() };
+	double seconds{ std::chrono::duration<double>(now - m_lastReport).count() };
+	size_t frames{ m_totals[static_cast<size_t>(ProfileStage::Frame)].size() };
+	out << std::fixed << std::setprecision(3);
+	out << frames << " frames in " << seconds << " s, " << frames / seconds << " FPS";
+	if (dropped > 0) {
+		out << " (" << dropped << " samples overwritten)";
+	}
+	out << '\n';
+	for (size_t stage{ 0 }; stage < m_totals.size(); ++stage) {
+		std::vector<double>& totals{ m_totals[stage] };
+		if (totals.empty()) {
+			continue;
+		}
+		out << "  " << std::left << std::setw(10) << STAGE_NAMES[stage] << std::right
+			<< " p50 " << std::setw(8) << percentile(totals, 0.50) << " ms"
+			<< "  p95 " << std::setw(8) << percentile(totals, 0.95) << " ms"
+			<< "  p99 " << std::setw(8) << percentile(totals, 0.99) << " ms\n";
+	}
+	out.unsetf(std::ios::floatfield);
+	out << std::setprecision(6) << std::flush;
+
+	m_reported = end;
+	m_lastReport = now;
+}
+
+StageProfiler& stageProfiler() {
+	static StageProfiler profiler;
+	return profiler;
+}
+#endif
@@ -0,0 +1,61 @@
+#include "scene_graph.h"
+#include <algorithm>
+#include <iostream>
+
+SceneGraph::NodeId SceneGraph::addNode(NodeId parent, const glm::mat4& localTransform) {
+	NodeId node{ static_cast<NodeId>(m_parents.size()) };
+	if (parent != NO_PARENT && parent >= node) {
+		std::cout << "SCENE GRAPH ERROR: parent " << parent << " of node " << node << " does not exist" << std::endl;
+		exit(1);
+	}
+	m_parents.push_back(parent);
+	m_local.push_back(localTransform);
+	m_world.push_back(localTransform);
+	m_dirty.push_back(1);
+	m_updatedIn.push_back(0);
+	m_firstDirty = std::min<size_t>(m_firstDirty, node);
+	return node;
+}
+
+void SceneGraph::setLocalTransform(NodeId node, const glm::mat4& localTransform) {
+	m_local[node] = localTransform;
+	m_dirty[node] = 1;
+	m_firstDirty = std::min<size_t>(m_firstDirty, node);
+}
+
+size_t SceneGraph::updateWorldTransforms() {
+	size_t count{ m_parents.size() };
+	if (m_firstDirty >= count) {
+		return 0;
+	}
+	// Sweep numbers start at 1, so a node that has never been recomputed (0) never matches.
+	if (++m_sweep == 0) {
+		std::fill(m_updatedIn.begin(), m_updatedIn.end(), 0);
+		m_sweep = 1;
+	}
+
+	size_t updated{ 0 };
+	for (size_t node{ m_firstDirty }; node < count; ++node) {
+		NodeId parent{ m_parents[node] };
+		bool parentMoved{ parent != NO_PARENT && m_updatedIn[parent] == m_sweep };
+		if (!m_dirty[node] && !parentMoved) {
+			continue;
+		}
+		m_world[node] = parent == NO_PARENT ? m_local[node] : m_world[parent] * m_local[node];
+		m_dirty[node] = 0;
+		m_updatedIn[node] = m_sweep;
+		++updated;
+	}
+	m_firstDirty = count;
+	return updated;
+}
+
+void SceneGraph::recomputeAllWorldTransforms() {
+	size_t count{ m_parents.size() };
+	for (size_t node{ 0 }; node < count; ++node) {
+		NodeId parent{ m_parents[node] };
+		m_world[node] = parent == NO_PARENT ? m_local[node] : m_world[parent] * m_local[node];
+		m_dirty[node] = 0;
+	}
+	m_firstDirty = count;
+}
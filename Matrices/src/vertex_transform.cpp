@@ -0,0 +1,205 @@
+#include "vertex_transform.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VERTEX_TRANSFORM_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only let a function use AVX2 intrinsics when it is marked for that target, so
+// the rest of the program can still run on CPUs without it. MSVC allows them anywhere.
+#if defined(VERTEX_TRANSFORM_X86) && !defined(_MSC_VER)
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace {
+	// Screen coordinates are clamped to this magnitude before converting to integers.
+	const float SCREEN_LIMIT{ 1073741824.0f }; // 2^30
+
+	// The pieces of the MVP matrix and viewport mapping that the kernels need. Only rows x, y,
+	// and w of the matrix matter, because we do not keep depth.
+	struct TransformConstants {
+		float xRow[4];
+		float yRow[4];
+		float wRow[4];
+		float halfWidth;
+		float halfHeight;
+	};
+
+	TransformConstants makeConstants(const float* mvp, float viewportWidth, float viewportHeight) {
+		TransformConstants constants{};
+		for (int col{ 0 }; col < 4; ++col) {
+			constants.xRow[col] = mvp[col * 4 + 0];
+			constants.yRow[col] = mvp[col * 4 + 1];
+			constants.wRow[col] = mvp[col * 4 + 3];
+		}
+		constants.halfWidth = viewportWidth / 2.0f;
+		constants.halfHeight = viewportHeight / 2.0f;
+		return constants;
+	}
+
+	// Written so that NaN clamps to the lower limit, matching the SIMD max/min instructions.
+	int32_t toScreenInteger(float value) {
+		value = value > -SCREEN_LIMIT ? value : -SCREEN_LIMIT;
+		value = value < SCREEN_LIMIT ? value : SCREEN_LIMIT;
+		return static_cast<int32_t>(value);
+	}
+
+	void transformScalar(const TransformConstants& c, const PositionsSoA& positions,
+		ScreenPositionsSoA& screen, size_t begin, size_t end) {
+		for (size_t i{ begin }; i < end; ++i) {
+			float x{ positions.x[i] };
+			float y{ positions.y[i] };
+			float z{ positions.z[i] };
+			float clipX{ c.xRow[0] * x + c.xRow[1] * y + c.xRow[2] * z + c.xRow[3] };
+			float clipY{ c.yRow[0] * x + c.yRow[1] * y + c.yRow[2] * z + c.yRow[3] };
+			float clipW{ c.wRow[0] * x + c.wRow[1] * y + c.wRow[2] * z + c.wRow[3] };
+
+			// Perspective divide, then map [-1, 1] to [0, width] and [1, -1] to [0, height].
+			screen.x[i] = toScreenInteger(clipX / clipW * c.halfWidth + c.halfWidth);
+			screen.y[i] = toScreenInteger(c.halfHeight - clipY / clipW * c.halfHeight);
+		}
+	}
+
+#ifdef VERTEX_TRANSFORM_X86
+	// 4 vertices per iteration with SSE2, which every x86-64 CPU has. Returns how many vertices
+	// it processed; the caller finishes the rest with the scalar kernel.
+	size_t transformSse(const TransformConstants& c, const PositionsSoA& positions, ScreenPositionsSoA& screen) {
+		size_t count{ positions.x.size() & ~size_t{ 3 } };
+		__m128 lower{ _mm_set1_ps(-SCREEN_LIMIT) };
+		__m128 upper{ _mm_set1_ps(SCREEN_LIMIT) };
+		__m128 halfWidth{ _mm_set1_ps(c.halfWidth) };
+		__m128 halfHeight{ _mm_set1_ps(c.halfHeight) };
+		for (size_t i{ 0 }; i < count; i += 4) {
+			__m128 x{ _mm_loadu_ps(positions.x.data() + i) };
+			__m128 y{ _mm_loadu_ps(positions.y.data() + i) };
+			__m128 z{ _mm_loadu_ps(positions.z.data() + i) };
+			auto row{ [&](const float* m) {
+				__m128 sum{ _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0]), x), _mm_set1_ps(m[3])) };
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[1]), y));
+				return _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[2]), z));
+			} };
+			__m128 inverseW{ _mm_div_ps(_mm_set1_ps(1.0f), row(c.wRow)) };
+			__m128 screenX{ _mm_add_ps(_mm_mul_ps(_mm_mul_ps(row(c.xRow), inverseW), halfWidth), halfWidth) };
+			__m128 screenY{ _mm_sub_ps(halfHeight, _mm_mul_ps(_mm_mul_ps(row(c.yRow), inverseW), halfHeight)) };
+			screenX = _mm_min_ps(_mm_max_ps(screenX, lower), upper);
+			screenY = _mm_min_ps(_mm_max_ps(screenY, lower), upper);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(screen.x.data() + i), _mm_cvttps_epi32(screenX));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(screen.y.data() + i), _mm_cvttps_epi32(screenY));
+		}
+		return count;
+	}
+
+	// 8 vertices per iteration with AVX2 and FMA.
+	TARGET_AVX2 size_t transformAvx2(const TransformConstants& c, const PositionsSoA& positions, ScreenPositionsSoA& screen) {
+		size_t count{ positions.x.size() & ~size_t{ 7 } };
+		__m256 lower{ _mm256_set1_ps(-SCREEN_LIMIT) };
+		__m256 upper{ _mm256_set1_ps(SCREEN_LIMIT) };
+		__m256 halfWidth{ _mm256_set1_ps(c.halfWidth) };
+		__m256 halfHeight{ _mm256_set1_ps(c.halfHeight) };
+		__m256 xRow[4];
+		__m256 yRow[4];
+		__m256 wRow[4];
+		for (int col{ 0 }; col < 4; ++col) {
+			xRow[col] = _mm256_set1_ps(c.xRow[col]);
+			yRow[col] = _mm256_set1_ps(c.yRow[col]);
+			wRow[col] = _mm256_set1_ps(c.wRow[col]);
+		}
+		for (size_t i{ 0 }; i < count; i += 8) {
+			__m256 x{ _mm256_loadu_ps(positions.x.data() + i) };
+			__m256 y{ _mm256_loadu_ps(positions.y.data() + i) };
+			__m256 z{ _mm256_loadu_ps(positions.z.data() + i) };
+			__m256 clipX{ _mm256_fmadd_ps(xRow[2], z, _mm256_fmadd_ps(xRow[1], y, _mm256_fmadd_ps(xRow[0], x, xRow[3]))) };
+			__m256 clipY{ _mm256_fmadd_ps(yRow[2], z, _mm256_fmadd_ps(yRow[1], y, _mm256_fmadd_ps(yRow[0], x, yRow[3]))) };
+			__m256 clipW{ _mm256_fmadd_ps(wRow[2], z, _mm256_fmadd_ps(wRow[1], y, _mm256_fmadd_ps(wRow[0], x, wRow[3]))) };
+
+			__m256 inverseW{ _mm256_div_ps(_mm256_set1_ps(1.0f), clipW) };
+			__m256 screenX{ _mm256_fmadd_ps(_mm256_mul_ps(clipX, inverseW), halfWidth, halfWidth) };
+			__m256 screenY{ _mm256_fnmadd_ps(_mm256_mul_ps(clipY, inverseW), halfHeight, halfHeight) };
+			screenX = _mm256_min_ps(_mm256_max_ps(screenX, lower), upper);
+			screenY = _mm256_min_ps(_mm256_max_ps(screenY, lower), upper);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(screen.x.data() + i), _mm256_cvttps_epi32(screenX));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(screen.y.data() + i), _mm256_cvttps_epi32(screenY));
+		}
+		return count;
+	}
+
+	bool cpuSupportsAvx2() {
+#if defined(_MSC_VER)
+		int info[4]{};
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		__cpuid(info, 1);
+		bool fma{ (info[2] & (1 << 12)) != 0 };
+		bool osSavesAvx{ (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6 };
+		__cpuidex(info, 7, 0);
+		bool avx2{ (info[1] & (1 << 5)) != 0 };
+		return fma && osSavesAvx && avx2;
+#else
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	}
+#endif
+}
+
+PositionsSoA toStructureOfArrays(const std::vector<Vertex3D>& vertices) {
+	PositionsSoA positions{};
+	positions.x.reserve(vertices.size());
+	positions.y.reserve(vertices.size());
+	positions.z.reserve(vertices.size());
+	for (const Vertex3D& vertex : vertices) {
+		positions.x.push_back(vertex.x);
+		positions.y.push_back(vertex.y);
+		positions.z.push_back(vertex.z);
+	}
+	return positions;
+}
+
+SimdLevel detectSimdLevel() {
+#ifdef VERTEX_TRANSFORM_X86
+	static const SimdLevel level{ cpuSupportsAvx2() ? SimdLevel::AVX2 : SimdLevel::SSE };
+	return level;
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level) {
+	switch (level) {
+	case SimdLevel::AVX2:
+		return "AVX2";
+	case SimdLevel::SSE:
+		return "SSE";
+	default:
+		return "scalar";
+	}
+}
+
+void transformToScreen(const float* mvp, const PositionsSoA& positions,
+	float viewportWidth, float viewportHeight, ScreenPositionsSoA& screen, SimdLevel level) {
+	TransformConstants constants{ makeConstants(mvp, viewportWidth, viewportHeight) };
+	screen.x.resize(positions.x.size());
+	screen.y.resize(positions.x.size());
+
+	size_t done{ 0 };
+#ifdef VERTEX_TRANSFORM_X86
+	if (level == SimdLevel::AVX2) {
+		done = transformAvx2(constants, positions, screen);
+	}
+	else if (level == SimdLevel::SSE) {
+		done = transformSse(constants, positions, screen);
+	}
+#endif
+	transformScalar(constants, positions, screen, done, positions.x.size());
+}
+
+void transformToScreen(const float* mvp, const PositionsSoA& positions,
+	float viewportWidth, float viewportHeight, ScreenPositionsSoA& screen) {
+	transformToScreen(mvp, positions, viewportWidth, viewportHeight, screen, detectSimdLevel());
+}
@@ -5,14 +5,20 @@
 #include <glm/ext.hpp>
 #include <vector>
 #include "triangles.h"
+#include "profiler.h"
 
-#define LOG_FPS
+// Comment out to submit every line to the window with its own draw call, instead of
+// rasterizing into our own framebuffer and presenting it once per frame.
+#define USE_FRAMEBUFFER
 struct Vertex2D {
 	int32_t x;
 	int32_t y;
 };
 
-void drawMesh(sf::RenderWindow& window, const std::vector<Vertex2D>& vertices, const std::vector<uint32_t>& faces) {
+// RenderTarget is either the sf::RenderWindow itself, or a Framebuffer that we draw into.
+template <typename RenderTarget>
+void drawMesh(RenderTarget& target, const std::vector<Vertex2D>& vertices, const std::vector<uint32_t>& faces) {
+	PROFILE_STAGE(ProfileStage::Raster);
 	// Loop through the list of face indexes, 3 at a time.
 	// Pull each vertex out of the vertices list.
 	// Draw a triangle connecting them.
@@ -21,7 +27,7 @@ void drawMesh(sf::RenderWindow& window, const std::vector<Vertex2D>& vertices, c
 		auto& vertexB{ vertices[faces[i + 1]] };
 		auto& vertexC{ vertices[faces[i + 2]] };
 
-		drawTriangle(window,
+		drawTriangle(target,
 			sf::Vector2i{ vertexA.x, vertexA.y },
 			sf::Vector2i{ vertexB.x, vertexB.y },
 			sf::Vector2i{ vertexC.x, vertexC.y },
@@ -33,7 +39,7 @@ void drawMesh(sf::RenderWindow& window, const std::vector<Vertex2D>& vertices, c
 
 int main() {
 	sf::RenderWindow window{ sf::VideoMode::getFullscreenModes().at(0), "SFML Demo" };
-	sf::Clock c;
+	Framebuffer framebuffer{ window.getSize() };
 
 	// Define the vertices and faces of the mesh we're drawing.
 	std::vector<Vertex2D> houseVertices {
@@ -48,8 +54,8 @@ int main() {
 	};
 
 
-	auto last{ c.getElapsedTime() };
 	while (window.isOpen()) {
+		PROFILE_STAGE(ProfileStage::Frame);
 		// Check for events.
 		while (const std::optional event{ window.pollEvent() }) {
 			if (event->is<sf::Event::Closed>()) {
@@ -57,16 +63,22 @@ int main() {
 			}
 		}
 
-#ifdef LOG_FPS
-		// FPS calculation.
-		auto now{ c.getElapsedTime() };
-		auto diff{ now - last };
-		std::cout << 1 / diff.asSeconds() << " FPS " << std::endl;
-		last = now;
+#ifdef ENABLE_PROFILER
+		if (stageProfiler().reportDue()) {
+			stageProfiler().report(std::cout);
+		}
 #endif
 		// Render the scene.
+#ifdef USE_FRAMEBUFFER
+		framebuffer.clear();
+		drawMesh(framebuffer, houseVertices, houseFaces);
+		PROFILE_STAGE(ProfileStage::Present);
+		framebuffer.present(window);
+#else
 		window.clear();
 		drawMesh(window, houseVertices, houseFaces);
+		PROFILE_STAGE(ProfileStage::Present);
+#endif
 		window.display();
 	}
 
@@ -1,4 +1,30 @@
 ﻿#pragma once
 #include <SFML/Graphics.hpp>
+#include "framebuffer.h"
 void drawPixel(sf::RenderWindow& window, sf::Vector2i position, sf::Color color);
 void drawLine(sf::RenderWindow& window, sf::Vector2i start, sf::Vector2i end, sf::Color color);
+
+void drawPixel(Framebuffer& framebuffer, sf::Vector2i position, sf::Color color);
+void drawLine(Framebuffer& framebuffer, sf::Vector2i start, sf::Vector2i end, sf::Color color);
+
+// Collects line segments into one retained sf::VertexArray, so a whole mesh reaches the window in a
+// single draw call. Flushing keeps the array's capacity, so once the first frame has sized it,
+// later frames append without reallocating.
+class LineBatch {
+public:
+	explicit LineBatch(sf::RenderWindow& window);
+
+	// The window's view, so drawMesh can map clip coordinates to pixels as it would for the window.
+	const sf::View& getView() const { return m_window.getView(); }
+
+	void append(sf::Vector2i start, sf::Vector2i end, sf::Color color);
+
+	// Draws every collected line with one window.draw call, then empties the batch.
+	void flush();
+
+private:
+	sf::RenderWindow& m_window;
+	sf::VertexArray m_lines;
+};
+
+void drawLine(LineBatch& batch, sf::Vector2i start, sf::Vector2i end, sf::Color color);
@@ -5,8 +5,11 @@
 #include <glm/ext.hpp>
 #include <vector>
 #include "triangles.h"
+#include "profiler.h"
 
-#define LOG_FPS
+// Comment out to submit every line to the window with its own draw call, instead of
+// rasterizing into our own framebuffer and presenting it once per frame.
+#define USE_FRAMEBUFFER
 struct Vertex3D {
 	float x;
 	float y;
@@ -22,7 +25,11 @@ sf::Vector2i clipToScreen(const sf::View& viewport, const Vertex3D& clip) {
 	return sf::Vector2i{ xs, ys };
 }
 
-void drawMesh(sf::RenderWindow& window, const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces) {
+// RenderTarget is either the sf::RenderWindow itself, or a Framebuffer that we draw into.
+template <typename RenderTarget>
+void drawMesh(RenderTarget& target, const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces) {
+	// Each face is transformed and drawn in one step, so both count as raster time.
+	PROFILE_STAGE(ProfileStage::Raster);
 	// Loop through the list of face indexes, 3 at a time.
 	// Pull each vertex out of the vertices list.
 	// Transform them from clip coordinates to screen coordinates.
@@ -32,12 +39,12 @@ void drawMesh(sf::RenderWindow& window, const std::vector<Vertex3D>& vertices, c
 		auto& vertexB{ vertices[faces[i + 1]] };
 		auto& vertexC{ vertices[faces[i + 2]] };
 
-		auto viewport{ window.getView() };
+		auto viewport{ target.getView() };
 		auto screenA{ clipToScreen(viewport, vertexA) };
 		auto screenB{ clipToScreen(viewport, vertexB) };
 		auto screenC{ clipToScreen(viewport, vertexC) };
 
-		drawTriangle(window,
+		drawTriangle(target,
 			sf::Vector2i{ screenA.x, screenA.y },
 			sf::Vector2i{ screenB.x, screenB.y },
 			sf::Vector2i{ screenC.x, screenC.y },
@@ -49,7 +56,7 @@ void drawMesh(sf::RenderWindow& window, const std::vector<Vertex3D>& vertices, c
 
 int main() {
 	sf::RenderWindow window{ sf::VideoMode::getFullscreenModes().at(0), "SFML Demo" };
-	sf::Clock c;
+	Framebuffer framebuffer{ window.getSize() };
 
 	// Define the vertices and faces of the mesh we're drawing.
 	std::vector<Vertex3D> cubeVertices {
@@ -77,8 +84,8 @@ int main() {
 		2, 7, 3
 	};
 
-	auto last{ c.getElapsedTime() };
 	while (window.isOpen()) {
+		PROFILE_STAGE(ProfileStage::Frame);
 		// Check for events.
 		while (const std::optional event{ window.pollEvent() }) {
 			if (event->is<sf::Event::Closed>()) {
@@ -86,16 +93,22 @@ int main() {
 			}
 		}
 
-#ifdef LOG_FPS
-		// FPS calculation.
-		auto now{ c.getElapsedTime() };
-		auto diff{ now - last };
-		std::cout << 1 / diff.asSeconds() << " FPS " << std::endl;
-		last = now;
+#ifdef ENABLE_PROFILER
+		if (stageProfiler().reportDue()) {
+			stageProfiler().report(std::cout);
+		}
 #endif
 		// Render the scene.
+#ifdef USE_FRAMEBUFFER
+		framebuffer.clear();
+		drawMesh(framebuffer, cubeVertices, cubeFaces);
+		PROFILE_STAGE(ProfileStage::Present);
+		framebuffer.present(window);
+#else
 		window.clear();
 		drawMesh(window, cubeVertices, cubeFaces);
+		PROFILE_STAGE(ProfileStage::Present);
+#endif
 		window.display();
 	}
 
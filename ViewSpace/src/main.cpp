@@ -4,8 +4,11 @@
 #include <numbers>
 
 #include "triangles.h"
+#include "profiler.h"
 
-#define LOG_FPS
+// Comment out to submit every line to the window with its own draw call, instead of
+// rasterizing into our own framebuffer and presenting it once per frame.
+#define USE_FRAMEBUFFER
 struct Vertex3D {
 	float x;
 	float y;
@@ -28,7 +31,12 @@ Vertex3D viewToClip(const Frustum& frustum, const Vertex3D& view) {
 	float yp{ view.y * -frustum.near / view.z };
 	float xClip{ xp / frustum.right };
 	float yClip{ yp / frustum.top };
-	return Vertex3D{ xClip, yClip, 0.0f };
+	// Depth goes from -1 at the near plane to 1 at the far plane, the same as OpenGL's
+	// perspective projection after the divide by w. Our wireframes don't use it yet, but a
+	// depth buffer would.
+	float zClip{ (frustum.far + frustum.near) / (frustum.far - frustum.near)
+		+ 2 * frustum.far * frustum.near / ((frustum.far - frustum.near) * view.z) };
+	return Vertex3D{ xClip, yClip, zClip };
 }
 
 // Linear interpolate from clip coordinates to screen coordinates.
@@ -38,8 +46,12 @@ sf::Vector2i clipToScreen(const sf::View& viewport, const Vertex3D& clip) {
 	return sf::Vector2i{ xs, ys };
 }
 
-void drawMesh(sf::RenderWindow& window, const Frustum& frustum,
+// RenderTarget is either the sf::RenderWindow itself, or a Framebuffer that we draw into.
+template <typename RenderTarget>
+void drawMesh(RenderTarget& target, const Frustum& frustum,
 	const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces) {
+	// Each face is transformed and drawn in one step, so both count as raster time.
+	PROFILE_STAGE(ProfileStage::Raster);
 	// Loop through the list of face indexes, 3 at a time.
 	// Pull each vertex out of the vertices list.
 	// Transform them from clip coordinates to screen coordinates.
@@ -53,12 +65,12 @@ void drawMesh(sf::RenderWindow& window, const Frustum& frustum,
 		auto clipB{ viewToClip(frustum, vertexB) };
 		auto clipC{ viewToClip(frustum, vertexC) };
 
-		auto& viewport{ window.getView() };
+		auto& viewport{ target.getView() };
 		auto screenA{ clipToScreen(viewport, clipA) };
 		auto screenB{ clipToScreen(viewport, clipB) };
 		auto screenC{ clipToScreen(viewport, clipC) };
 
-		drawTriangle(window,
+		drawTriangle(target,
 			sf::Vector2i{ screenA.x, screenA.y },
 			sf::Vector2i{ screenB.x, screenB.y },
 			sf::Vector2i{ screenC.x, screenC.y },
@@ -71,7 +83,7 @@ void drawMesh(sf::RenderWindow& window, const Frustum& frustum,
 int main() {
 	sf::RenderWindow window{ sf::VideoMode::getFullscreenModes().at(0), "SFML Demo" };
 
-	sf::Clock c;
+	Framebuffer framebuffer{ window.getSize() };
 
 	// Define the vertices and faces of the mesh we're drawing.
 	// These are now VIEW COORDINATES, so we need to "back away" from the camera,
@@ -113,8 +125,8 @@ int main() {
 	float l{ -r };
 	Frustum frustum{ near, far, l, r, b, t };
 
-	auto last{ c.getElapsedTime() };
 	while (window.isOpen()) {
+		PROFILE_STAGE(ProfileStage::Frame);
 		// Check for events.
 		while (const std::optional event{ window.pollEvent() }) {
 			if (event->is<sf::Event::Closed>()) {
@@ -122,16 +134,22 @@ int main() {
 			}
 		}
 
-#ifdef LOG_FPS
-		// FPS calculation.
-		auto now{ c.getElapsedTime() };
-		auto diff{ now - last };
-		std::cout << 1 / diff.asSeconds() << " FPS " << std::endl;
-		last = now;
+#ifdef ENABLE_PROFILER
+		if (stageProfiler().reportDue()) {
+			stageProfiler().report(std::cout);
+		}
 #endif
 		// Render the scene.
+#ifdef USE_FRAMEBUFFER
+		framebuffer.clear();
+		drawMesh(framebuffer, frustum, cubeVertices, cubeFaces);
+		PROFILE_STAGE(ProfileStage::Present);
+		framebuffer.present(window);
+#else
 		window.clear();
 		drawMesh(window, frustum, cubeVertices, cubeFaces);
+		PROFILE_STAGE(ProfileStage::Present);
+#endif
 		window.display();
 	}
 
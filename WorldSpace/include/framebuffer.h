@@ -0,0 +1,53 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A CPU-side image with one 32-bit RGBA value per pixel, stored row by row. Our line and triangle
+// routines write into it directly, and the finished frame is handed to SFML with a single texture
+// upload instead of one window.draw call per pixel or per line.
+class Framebuffer {
+public:
+	explicit Framebuffer(sf::Vector2u size);
+
+	sf::Vector2u getSize() const { return m_size; }
+
+	// A view with the same size as the framebuffer, so code written against
+	// sf::RenderWindow::getView() can map clip coordinates to framebuffer pixels unchanged.
+	const sf::View& getView() const { return m_view; }
+
+	std::uint32_t* data() { return m_pixels.data(); }
+	const std::uint32_t* data() const { return m_pixels.data(); }
+
+	// Fills every pixel with the given color.
+	void clear(sf::Color color = sf::Color::Black);
+
+	// Writes one pixel. Positions outside the framebuffer are ignored.
+	void setPixel(int32_t x, int32_t y, std::uint32_t packedColor) {
+		if (x >= 0 && y >= 0 && static_cast<uint32_t>(x) < m_size.x && static_cast<uint32_t>(y) < m_size.y) {
+			m_pixels[static_cast<size_t>(y) * m_size.x + x] = packedColor;
+		}
+	}
+
+	// Uploads the pixels to a texture and draws it over the whole window.
+	void present(sf::RenderWindow& window);
+
+	// Writes the pixels to an image file, without needing a window. Files ending in .ppm are
+	// written directly as binary PPM; other extensions (.png, .bmp, .tga, .jpg) go through
+	// sf::Image. Returns false if the file could not be written.
+	bool saveToFile(const std::string& path) const;
+
+	// Converts a color to the value we store per pixel. SFML expects the bytes of each pixel in
+	// R, G, B, A order; on the little-endian machines we target, that means red is the low byte.
+	static std::uint32_t pack(sf::Color color) {
+		return static_cast<std::uint32_t>(color.r) | (static_cast<std::uint32_t>(color.g) << 8)
+			| (static_cast<std::uint32_t>(color.b) << 16) | (static_cast<std::uint32_t>(color.a) << 24);
+	}
+
+private:
+	sf::Vector2u m_size;
+	std::vector<std::uint32_t> m_pixels;
+	sf::View m_view;
+	sf::Texture m_texture;
+};
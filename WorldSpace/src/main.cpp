@@ -1,11 +1,17 @@
 ﻿#include <SFML/Graphics.hpp>
 #include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <vector>
 #include <numbers>
 
 #include "triangles.h"
+#include "profiler.h"
 
-#define LOG_FPS
+// Comment out to submit every line to the window with its own draw call, instead of
+// rasterizing into our own framebuffer and presenting it once per frame.
+#define USE_FRAMEBUFFER
 struct Vertex3D {
 	float x;
 	float y;
@@ -46,19 +52,112 @@ Vertex3D worldToView(const sf::Vector3f& cameraPosition, const sf::Vector3f& cam
 	float pitchZ{ rollY * std::sin(cOrientation.x) + rollZ * std::cos(cOrientation.x) };
 
 	float yawX{ pitchX * std::cos(cOrientation.y) + pitchZ * std::sin(cOrientation.y) };
-	float yawY{ vertex.y };
+	float yawY{ pitchY };
 	float yawZ{ -pitchX * std::sin(cOrientation.y) + pitchZ * std::cos(cOrientation.y) };
 
 	return Vertex3D{ yawX, yawY, yawZ};
 }
 
+// An affine transform stored as a 3x4 matrix: a 3x3 linear part in the first three columns and a
+// translation in the last. Compiling the camera's pose into one of these once per draw call
+// replaces the sines and cosines that worldToView evaluates for every vertex.
+struct AffineTransform {
+	float m[3][4];
+};
+
+// Returns the transform that applies `first`, then `second`.
+AffineTransform compose(const AffineTransform& second, const AffineTransform& first) {
+	AffineTransform result{};
+	for (int row{ 0 }; row < 3; ++row) {
+		for (int col{ 0 }; col < 4; ++col) {
+			result.m[row][col] = second.m[row][0] * first.m[0][col]
+				+ second.m[row][1] * first.m[1][col]
+				+ second.m[row][2] * first.m[2][col];
+		}
+		result.m[row][3] += second.m[row][3];
+	}
+	return result;
+}
+
+// Rotations around a single axis, matching the yaw, pitch, and roll steps of worldToView.
+AffineTransform yawTransform(float angle) {
+	float c{ std::cos(angle) };
+	float s{ std::sin(angle) };
+	return AffineTransform{ {
+		{ c, 0, s, 0 },
+		{ 0, 1, 0, 0 },
+		{ -s, 0, c, 0 }
+	} };
+}
+
+AffineTransform pitchTransform(float angle) {
+	float c{ std::cos(angle) };
+	float s{ std::sin(angle) };
+	return AffineTransform{ {
+		{ 1, 0, 0, 0 },
+		{ 0, c, -s, 0 },
+		{ 0, s, c, 0 }
+	} };
+}
+
+AffineTransform rollTransform(float angle) {
+	float c{ std::cos(angle) };
+	float s{ std::sin(angle) };
+	return AffineTransform{ {
+		{ c, -s, 0, 0 },
+		{ s, c, 0, 0 },
+		{ 0, 0, 1, 0 }
+	} };
+}
+
+// The same transformation as worldToView, compiled once for the camera.
+AffineTransform worldToViewTransform(const sf::Vector3f& cameraPosition, const sf::Vector3f& cameraOrientation) {
+	AffineTransform translate{ {
+		{ 1, 0, 0, -cameraPosition.x },
+		{ 0, 1, 0, -cameraPosition.y },
+		{ 0, 0, 1, -cameraPosition.z }
+	} };
+	return compose(yawTransform(-cameraOrientation.y),
+		compose(pitchTransform(-cameraOrientation.x),
+			compose(rollTransform(-cameraOrientation.z), translate)));
+}
+
+// Applies an affine transform to a vertex: three multiply-add chains, which the compiler can emit
+// as fused multiply-add instructions.
+Vertex3D transformVertex(const AffineTransform& transform, const Vertex3D& vertex) {
+	const auto& m{ transform.m };
+	return Vertex3D{
+		m[0][0] * vertex.x + m[0][1] * vertex.y + m[0][2] * vertex.z + m[0][3],
+		m[1][0] * vertex.x + m[1][1] * vertex.y + m[1][2] * vertex.z + m[1][3],
+		m[2][0] * vertex.x + m[2][1] * vertex.y + m[2][2] * vertex.z + m[2][3]
+	};
+}
+
+// The compiled transforms perform the same arithmetic as the step-by-step functions, grouped
+// differently, so the two paths differ only by float rounding. We consider them to match when
+// each coordinate agrees to within TRANSFORM_TOLERANCE, relative to the coordinate's magnitude
+// (or absolutely, for coordinates smaller than 1).
+const float TRANSFORM_TOLERANCE{ 1e-4f };
+
+bool matchesWithinTolerance(const Vertex3D& actual, const Vertex3D& expected) {
+	auto close{ [](float a, float e) {
+		return std::abs(a - e) <= TRANSFORM_TOLERANCE * std::max(1.0f, std::abs(e));
+	} };
+	return close(actual.x, expected.x) && close(actual.y, expected.y) && close(actual.z, expected.z);
+}
+
 // Transform from view coordinates to clip coordinates.
 Vertex3D viewToClip(const Frustum& frustum, const Vertex3D& view) {
 	float xp{ view.x * -frustum.near / view.z };
 	float yp{ view.y * -frustum.near / view.z };
 	float xClip{ xp / frustum.right };
 	float yClip{ yp / frustum.top };
-	return Vertex3D{ xClip, yClip, 0.0f };
+	// Depth goes from -1 at the near plane to 1 at the far plane, the same as OpenGL's
+	// perspective projection after the divide by w. Our wireframes don't use it yet, but a
+	// depth buffer would.
+	float zClip{ (frustum.far + frustum.near) / (frustum.far - frustum.near)
+		+ 2 * frustum.far * frustum.near / ((frustum.far - frustum.near) * view.z) };
+	return Vertex3D{ xClip, yClip, zClip };
 }
 
 // Linear interpolate from clip coordinates to screen coordinates.
@@ -68,32 +167,42 @@ sf::Vector2i clipToScreen(const sf::View& viewport, const Vertex3D& clip) {
 	return sf::Vector2i{ xs, ys };
 }
 
-void drawMesh(sf::RenderWindow& window, const Frustum& frustum,
+// RenderTarget is either the sf::RenderWindow itself, or a Framebuffer that we draw into.
+template <typename RenderTarget>
+void drawMesh(RenderTarget& target, const Frustum& frustum,
 	const sf::Vector3f& cameraPosition, const sf::Vector3f& cameraOrientation,
 	const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& faces, sf::Color color) {
+	// Each face is transformed and drawn in one step, so both count as raster time.
+	PROFILE_STAGE(ProfileStage::Raster);
 	// Loop through the list of face indexes, 3 at a time.
 	// Pull each vertex out of the vertices list.
 	// Transform them from world -> view -> clip -> screen coordinates.
 	// Draw a triangle connecting them.
+	// The camera's transform is compiled once, so each vertex only costs one matrix multiply.
+	AffineTransform worldToViewMatrix{ worldToViewTransform(cameraPosition, cameraOrientation) };
 	for (size_t i{ 0 }; i < faces.size(); i = i + 3) {
 		auto& vertexA{ vertices[faces[i]] };
 		auto& vertexB{ vertices[faces[i + 1]] };
 		auto& vertexC{ vertices[faces[i + 2]] };
 
-		auto viewA{ worldToView(cameraPosition, cameraOrientation, vertexA) };
-		auto viewB{ worldToView(cameraPosition, cameraOrientation, vertexB) };
-		auto viewC{ worldToView(cameraPosition, cameraOrientation, vertexC) };
+		auto viewA{ transformVertex(worldToViewMatrix, vertexA) };
+		auto viewB{ transformVertex(worldToViewMatrix, vertexB) };
+		auto viewC{ transformVertex(worldToViewMatrix, vertexC) };
+		// Debug builds check the fast path against the step-by-step function.
+		assert(matchesWithinTolerance(viewA, worldToView(cameraPosition, cameraOrientation, vertexA)));
+		assert(matchesWithinTolerance(viewB, worldToView(cameraPosition, cameraOrientation, vertexB)));
+		assert(matchesWithinTolerance(viewC, worldToView(cameraPosition, cameraOrientation, vertexC)));
 
 		auto clipA{ viewToClip(frustum, viewA) };
 		auto clipB{ viewToClip(frustum, viewB) };
 		auto clipC{ viewToClip(frustum, viewC) };
 
-		auto& viewport{ window.getView() };
+		auto& viewport{ target.getView() };
 		auto screenA{ clipToScreen(viewport, clipA) };
 		auto screenB{ clipToScreen(viewport, clipB) };
 		auto screenC{ clipToScreen(viewport, clipC) };
 
-		drawTriangle(window,
+		drawTriangle(target,
 			sf::Vector2i{ screenA.x, screenA.y },
 			sf::Vector2i{ screenB.x, screenB.y },
 			sf::Vector2i{ screenC.x, screenC.y },
@@ -104,7 +213,7 @@ void drawMesh(sf::RenderWindow& window, const Frustum& frustum,
 
 int main() {
 	sf::RenderWindow window{ sf::VideoMode::getFullscreenModes().at(0), "SFML Demo" };
-	sf::Clock c;
+	Framebuffer framebuffer{ window.getSize() };
 
 	// Define the vertices and faces of the mesh we're drawing.
 	// These are now WORLD SPACE COORDINATES, in the same virtual space where 
@@ -151,8 +260,8 @@ int main() {
 	sf::Vector3f cameraOrientation{ 0, 0, 0 };
 
 
-	auto last{ c.getElapsedTime() };
 	while (window.isOpen()) {
+		PROFILE_STAGE(ProfileStage::Frame);
 		// Check for events.
 		while (const std::optional event{ window.pollEvent() }) {
 			if (event->is<sf::Event::Closed>()) {
@@ -177,17 +286,23 @@ int main() {
 			cameraOrientation = { 0, std::numbers::pi_v<float>/6, 0 };
 		}
 
-#ifdef LOG_FPS
-		// FPS calculation.
-		auto now{ c.getElapsedTime() };
-		auto diff{ now - last };
-		std::cout << 1 / diff.asSeconds() << " FPS " << std::endl;
-		last = now;
+#ifdef ENABLE_PROFILER
+		if (stageProfiler().reportDue()) {
+			stageProfiler().report(std::cout);
+		}
 #endif
 
 		// Render the scene.
+#ifdef USE_FRAMEBUFFER
+		framebuffer.clear();
+		drawMesh(framebuffer, frustum, cameraPosition, cameraOrientation, cubeVertices, cubeFaces, sf::Color::Red);
+		PROFILE_STAGE(ProfileStage::Present);
+		framebuffer.present(window);
+#else
 		window.clear();
 		drawMesh(window, frustum, cameraPosition, cameraOrientation, cubeVertices, cubeFaces, sf::Color::Red);
+		PROFILE_STAGE(ProfileStage::Present);
+#endif
 		window.display();
 	}
 